@@ -1,4 +1,5 @@
 #include <fstream>
+#include <sstream>
 #include "ns3/core-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/internet-apps-module.h"
@@ -19,6 +20,7 @@
 #include <ns3/propagation-loss-model.h>
 #include <ns3/propagation-delay-model.h>
 #include <ns3/single-model-spectrum-channel.h>
+#include "scenario-csv.h"
 
 using namespace ns3;
 
@@ -33,10 +35,21 @@ int main (int argc, char** argv) {
   uint32_t m_protocol=2;
   int nodeSpeed = 10; //in m/s
   int nodePause = 0; //in s
+  std::string flowmonFile = "";                    /* FlowMonitor XML output file (empty to disable). */
+  std::string resultsFile = "";                    /* Per-flow CSV results file, appended to (empty to disable). */
+  bool printFlows = false;                         /* Print the statistics of each flow. */
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("dataRate", "Application data ate", dataRate);
+  cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("nNodes", "Number of sensor nodes", nNodes);
+  cmd.AddValue ("nodeSpeed", "Maximum node speed in m/s", nodeSpeed);
+  cmd.AddValue ("nodePause", "Node pause time in s", nodePause);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("flowmonFile", "Write FlowMonitor statistics to this XML file", flowmonFile);
+  cmd.AddValue ("resultsFile", "Append per-flow statistics to this CSV file", resultsFile);
+  cmd.AddValue ("printFlows", "Print the statistics of each flow", printFlows);
   cmd.AddValue ("tcpVariant", "Transport protocol to use: TcpNewReno, "
                 "TcpHybla, TcpHighSpeed, TcpHtcp, TcpVegas, TcpScalable, TcpVeno, "
                 "TcpBic, TcpYeah, TcpIllinois, TcpWestwood,TcpCerl, TcpWestwoodPlus, TcpLedbat ", tcpVariant);
@@ -169,14 +182,7 @@ int main (int argc, char** argv) {
   std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
 
   int count=0;
-  /*float thr=0.0,dr=0.0,lr=0.0;
-  float dl=0.0;
-  std::ofstream myfile1,myfile2,myfile3,myfile4;
-  myfile1.open ("throughput_r.txt");
-  myfile2.open ("delay_r.txt");
-  myfile3.open ("delivery-ratio_r.txt");
-  myfile4.open ("loss-ratio_r.txt");
-  */
+  std::ostringstream results;                       /* Per-flow CSV rows, written once after the run */
  
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter)
   {
@@ -187,37 +193,52 @@ int main (int argc, char** argv) {
           
           count++;
           
-          NS_LOG_UNCOND("-------------------------------------------------------------");
-          NS_LOG_UNCOND("Flow ID:" <<iter->first);
-          NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
-          NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
-          NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
-          NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
-          NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
-          NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
-          
-          /*
-          thr=iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024;
-          if(thr==-0) thr=0; 
-          dl=iter->second.delaySum.GetSeconds();
-          dr=iter->second.rxPackets*100/iter->second.txPackets ;
-          lr=(iter->second.txPackets-iter->second.rxPackets)*100/iter->second.txPackets;
-          
-          myfile1<< count<<" "<<thr<<"\n";
-          myfile2 << count<<" "<<dl<<"\n";
-          myfile3 << count<<" "<<dr<<"\n";
-          myfile4<< count<<" "<<lr<<"\n";         
-          */
+          if (printFlows)
+            {
+              NS_LOG_UNCOND("-------------------------------------------------------------");
+              NS_LOG_UNCOND("Flow ID:" <<iter->first);
+              NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
+              NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
+              NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
+              NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
+              NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
+              NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
+            }
+          if (!resultsFile.empty ())
+            {
+              double duration = iter->second.timeLastRxPacket.GetSeconds () - iter->second.timeFirstTxPacket.GetSeconds ();
+              results << "lrwpan," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+                      << "," << nNodes << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+                      << "," << iter->first << "," << t.sourceAddress << "," << t.destinationAddress
+                      << "," << t.sourcePort << "," << t.destinationPort
+                      << "," << iter->second.txPackets << "," << iter->second.rxPackets << "," << iter->second.lostPackets
+                      << "," << iter->second.txBytes << "," << iter->second.rxBytes
+                      << "," << iter->second.delaySum.GetSeconds ()
+                      << "," << iter->second.timeFirstTxPacket.GetSeconds ()
+                      << "," << iter->second.timeLastRxPacket.GetSeconds ()
+                      << "," << CsvRatio (iter->second.rxPackets * 100.0, iter->second.txPackets)
+                      << "," << CsvRatio ((static_cast<double> (iter->second.txPackets) - iter->second.rxPackets) * 100.0,
+                                          iter->second.txPackets)
+                      << "," << CsvRatio (iter->second.rxBytes * 8.0 / 1024 / 1024, duration)
+                      << "\n";
+            }
   }
-  /*
-  myfile1.close();
-  myfile2.close();
-  myfile3.close();
-  myfile4.close();
-  */  
+  if (!resultsFile.empty ())
+    {
+      AppendCsv (resultsFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "flowId,sourceAddress,destinationAddress,sourcePort,destinationPort,"
+                 "txPackets,rxPackets,lostPackets,txBytes,rxBytes,delaySum,"
+                 "timeFirstTxPacket,timeLastRxPacket,deliveryRatio,lossRatio,throughput\n",
+                 results.str ());
+    }
   NS_LOG_UNCOND("------------------------------------------");
   NS_LOG_UNCOND("Total flows: " <<count);
 
+  if (!flowmonFile.empty ())
+    {
+      flowmon.SerializeToXmlFile (flowmonFile, false, false);
+    }
   Simulator::Destroy ();
 
   return 0;
@@ -1,9 +1,11 @@
 /*  WiFi Tcp Congestion Control for adhoc network*/
 
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include "ns3/command-line.h"
 #include "ns3/config.h"
+#include "ns3/rng-seed-manager.h"
 #include "ns3/string.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
@@ -23,6 +25,7 @@
 #include "ns3/pointer.h"
 #include "ns3/aodv-module.h"
 #include "ns3/ipv4-list-routing-helper.h"
+#include "scenario-csv.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp");
 
@@ -40,6 +43,9 @@ main (int argc, char *argv[])
   double simulationTime = 0.3;                         /* Simulation time in seconds. */
   bool pcapTracing = false;                          /* PCAP Tracing is enabled or not. */
   uint32_t m_protocol=2;
+  std::string flowmonFile = "";                      /* FlowMonitor XML output file (empty to disable). */
+  std::string resultsFile = "";                      /* Per-flow CSV results file, appended to (empty to disable). */
+  bool printFlows = false;                           /* Print the statistics of each flow. */
 
   int nWifis=30;
   int nodeSpeed = 10; //in m/s
@@ -57,6 +63,12 @@ main (int argc, char *argv[])
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("nWifis", "Number of wifi nodes", nWifis);
+  cmd.AddValue ("nodeSpeed", "Maximum node speed in m/s", nodeSpeed);
+  cmd.AddValue ("nodePause", "Node pause time in s", nodePause);
+  cmd.AddValue ("flowmonFile", "Write FlowMonitor statistics to this XML file", flowmonFile);
+  cmd.AddValue ("resultsFile", "Append per-flow statistics to this CSV file", resultsFile);
+  cmd.AddValue ("printFlows", "Print the statistics of each flow", printFlows);
   cmd.Parse (argc, argv);
 
   // Select TCP variant
@@ -159,14 +171,7 @@ main (int argc, char *argv[])
   std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
 
   int count=0;
-  /*float thr=0.0,dr=0.0,lr=0.0;
-  float dl=0.0;
-  std::ofstream myfile1,myfile2,myfile3,myfile4;
-  myfile1.open ("throughput_r.txt");
-  myfile2.open ("delay_r.txt");
-  myfile3.open ("delivery-ratio_r.txt");
-  myfile4.open ("loss-ratio_r.txt");
-  */
+  std::ostringstream results;                       /* Per-flow CSV rows, written once after the run */
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter)
   {
 	  Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
@@ -176,40 +181,53 @@ main (int argc, char *argv[])
           
           count++;
           
-          NS_LOG_UNCOND("-------------------------------------------------------------");
-          NS_LOG_UNCOND("Flow ID:" <<iter->first);
-          NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
-          NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
-          NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
-          NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
-          NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
-          NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
-          
-          /*
-          thr=iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024;
-          if(thr==-0) thr=0; 
-          dl=iter->second.delaySum.GetSeconds();
-          dr=iter->second.rxPackets*100/iter->second.txPackets ;
-          lr=(iter->second.txPackets-iter->second.rxPackets)*100/iter->second.txPackets;
-          
-          myfile1<< count<<" "<<thr<<"\n";
-          myfile2 << count<<" "<<dl<<"\n";
-          myfile3 << count<<" "<<dr<<"\n";
-          myfile4<< count<<" "<<lr<<"\n";         
-          */
+          if (printFlows)
+            {
+              NS_LOG_UNCOND("-------------------------------------------------------------");
+              NS_LOG_UNCOND("Flow ID:" <<iter->first);
+              NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
+              NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
+              NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
+              NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
+              NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
+              NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
+            }
+          if (!resultsFile.empty ())
+            {
+              double duration = iter->second.timeLastRxPacket.GetSeconds () - iter->second.timeFirstTxPacket.GetSeconds ();
+              results << "wifi," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+                      << "," << nWifis << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+                      << "," << iter->first << "," << t.sourceAddress << "," << t.destinationAddress
+                      << "," << t.sourcePort << "," << t.destinationPort
+                      << "," << iter->second.txPackets << "," << iter->second.rxPackets << "," << iter->second.lostPackets
+                      << "," << iter->second.txBytes << "," << iter->second.rxBytes
+                      << "," << iter->second.delaySum.GetSeconds ()
+                      << "," << iter->second.timeFirstTxPacket.GetSeconds ()
+                      << "," << iter->second.timeLastRxPacket.GetSeconds ()
+                      << "," << CsvRatio (iter->second.rxPackets * 100.0, iter->second.txPackets)
+                      << "," << CsvRatio ((static_cast<double> (iter->second.txPackets) - iter->second.rxPackets) * 100.0,
+                                          iter->second.txPackets)
+                      << "," << CsvRatio (iter->second.rxBytes * 8.0 / 1024 / 1024, duration)
+                      << "\n";
+            }
   }
-  /*
-  myfile1.close();
-  myfile2.close();
-  myfile3.close();
-  myfile4.close();
-  */
+  if (!resultsFile.empty ())
+    {
+      AppendCsv (resultsFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "flowId,sourceAddress,destinationAddress,sourcePort,destinationPort,"
+                 "txPackets,rxPackets,lostPackets,txBytes,rxBytes,delaySum,"
+                 "timeFirstTxPacket,timeLastRxPacket,deliveryRatio,lossRatio,throughput\n",
+                 results.str ());
+    }
+  if (!flowmonFile.empty ())
+    {
+      flowmon.SerializeToXmlFile (flowmonFile, false, false);
+    }
   Simulator::Destroy ();
   
   NS_LOG_UNCOND("------------------------------------------");
   NS_LOG_UNCOND("Total flows: " <<count);
   
-  //monitor->SerializeToXmlFile("tcp-new-reno.xml", true, true);
- 
   return 0;
 }
@@ -0,0 +1,277 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Microbenchmark of the per-ACK path of the congestion control algorithms.
+ *
+ * An ACK trace is replayed through the congestion control (PktsAcked and
+ * IncreaseWindow for each ACK, GetSsThresh for each loss) without the rest
+ * of the TCP stack, and the time and the number of heap allocations per
+ * ACK are reported for each algorithm.
+ *
+ * The trace is either read from a file, with one event per line:
+ *
+ *   <segmentsAcked> <rtt in seconds> <loss (0 or 1)>
+ *
+ * (lines starting with '#' are ignored), or generated with a base RTT,
+ * a random queueing delay and a random loss probability.
+ *
+ *   ./waf --run "bench-tcp-cerl --acks=1000000 --variants=TcpCerl,TcpNewReno,TcpVeno"
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "ns3/core-module.h"
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-socket-state.h"
+
+using namespace ns3;
+
+static uint64_t g_allocations = 0; //!< Number of calls to operator new
+
+void *
+operator new (std::size_t size)
+{
+  ++g_allocations;
+  void *p = std::malloc (size == 0 ? 1 : size);
+  if (p == 0)
+    {
+      throw std::bad_alloc ();
+    }
+  return p;
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+/**
+ * An event of the ACK trace
+ */
+struct AckEvent
+{
+  uint32_t segmentsAcked; //!< Segments acknowledged by the ACK
+  Time rtt;               //!< RTT sample carried by the ACK
+  bool loss;              //!< The ACK signals a loss (third dupack)
+};
+
+static std::vector<AckEvent>
+ReadTrace (const std::string &fileName)
+{
+  std::vector<AckEvent> trace;
+  std::ifstream in (fileName.c_str ());
+  NS_ABORT_MSG_UNLESS (in.is_open (), "Cannot open trace file " << fileName);
+
+  std::string line;
+  while (std::getline (in, line))
+    {
+      if (line.empty () || line[0] == '#')
+        {
+          continue;
+        }
+      std::istringstream iss (line);
+      AckEvent ev;
+      double rtt;
+      int loss = 0;
+      iss >> ev.segmentsAcked >> rtt >> loss;
+      NS_ABORT_MSG_IF (iss.fail () && !iss.eof (), "Malformed trace line: " << line);
+      ev.rtt = Seconds (rtt);
+      ev.loss = (loss != 0);
+      trace.push_back (ev);
+    }
+  return trace;
+}
+
+static std::vector<AckEvent>
+GenerateTrace (uint32_t acks, Time baseRtt, Time maxQueueDelay,
+               double lossProbability, uint32_t ackEvery)
+{
+  std::vector<AckEvent> trace;
+  trace.reserve (acks);
+
+  Ptr<UniformRandomVariable> delay = CreateObject<UniformRandomVariable> ();
+  Ptr<UniformRandomVariable> loss = CreateObject<UniformRandomVariable> ();
+
+  for (uint32_t i = 0; i < acks; ++i)
+    {
+      AckEvent ev;
+      ev.segmentsAcked = ackEvery;
+      ev.rtt = baseRtt + NanoSeconds (delay->GetInteger (0, maxQueueDelay.GetNanoSeconds ()));
+      ev.loss = (loss->GetValue () < lossProbability);
+      trace.push_back (ev);
+    }
+  return trace;
+}
+
+/**
+ * Replay the trace through a congestion control
+ *
+ * \param cong the congestion control
+ * \param trace the ACK trace
+ * \param segmentSize the segment size
+ * \param maxCwnd cWnd is capped to this value (in segments), to keep the
+ *        window in a realistic range over long traces
+ */
+static void
+Replay (Ptr<TcpCongestionOps> cong, const std::vector<AckEvent> &trace,
+        uint32_t segmentSize, uint32_t maxCwnd)
+{
+  Ptr<TcpSocketState> tcb = CreateObject<TcpSocketState> ();
+  tcb->m_segmentSize = segmentSize;
+  tcb->m_cWnd = 10 * segmentSize;
+  tcb->m_ssThresh = UINT32_MAX;
+  tcb->m_initialCWnd = 10;
+  tcb->m_initialSsThresh = UINT32_MAX;
+  cong->Init (tcb);
+
+  SequenceNumber32 lastAcked (1);
+
+  for (std::vector<AckEvent>::const_iterator it = trace.begin (); it != trace.end (); ++it)
+    {
+      // The sender keeps a full window in flight
+      lastAcked += it->segmentsAcked * segmentSize;
+      tcb->m_lastAckedSeq = lastAcked;
+      tcb->m_nextTxSequence = lastAcked + tcb->m_cWnd;
+      tcb->m_highTxMark = tcb->m_nextTxSequence;
+      tcb->m_bytesInFlight = tcb->m_cWnd;
+
+      if (it->loss)
+        {
+          tcb->m_ssThresh = cong->GetSsThresh (tcb, tcb->m_bytesInFlight);
+          tcb->m_cWnd = tcb->m_ssThresh;
+          continue;
+        }
+
+      cong->PktsAcked (tcb, it->segmentsAcked, it->rtt);
+      cong->IncreaseWindow (tcb, it->segmentsAcked);
+      if (tcb->m_cWnd > maxCwnd * segmentSize)
+        {
+          tcb->m_cWnd = maxCwnd * segmentSize;
+        }
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  std::string variants = "TcpCerl,TcpNewReno,TcpVeno";
+  std::string traceFile = "";
+  std::string saveTrace = "";
+  uint32_t acks = 1000000;
+  uint32_t iterations = 5;
+  uint32_t segmentSize = 100;
+  uint32_t ackEvery = 1;
+  uint32_t maxCwnd = 1000;
+  double baseRtt = 0.01;
+  double maxQueueDelay = 0.01;
+  double lossProbability = 0.001;
+
+  CommandLine cmd (__FILE__);
+  cmd.AddValue ("variants", "Comma-separated list of congestion controls", variants);
+  cmd.AddValue ("trace", "ACK trace file to replay (empty to generate one)", traceFile);
+  cmd.AddValue ("saveTrace", "Save the generated trace to this file", saveTrace);
+  cmd.AddValue ("acks", "Number of ACKs of the generated trace", acks);
+  cmd.AddValue ("iterations", "Number of replays of the trace", iterations);
+  cmd.AddValue ("segmentSize", "Segment size in bytes", segmentSize);
+  cmd.AddValue ("ackEvery", "Segments acknowledged by each ACK of the generated trace", ackEvery);
+  cmd.AddValue ("maxCwnd", "Upper bound of cWnd, in segments", maxCwnd);
+  cmd.AddValue ("baseRtt", "Propagation RTT of the generated trace, in seconds", baseRtt);
+  cmd.AddValue ("maxQueueDelay", "Maximum queueing delay of the generated trace, in seconds", maxQueueDelay);
+  cmd.AddValue ("lossProbability", "Loss probability of the generated trace", lossProbability);
+  cmd.Parse (argc, argv);
+
+  std::vector<AckEvent> trace;
+  if (traceFile.empty ())
+    {
+      trace = GenerateTrace (acks, Seconds (baseRtt), Seconds (maxQueueDelay),
+                             lossProbability, ackEvery);
+    }
+  else
+    {
+      trace = ReadTrace (traceFile);
+    }
+  NS_ABORT_MSG_IF (trace.empty (), "Empty ACK trace");
+
+  if (!saveTrace.empty ())
+    {
+      std::ofstream out (saveTrace.c_str ());
+      out << "# segmentsAcked rtt loss" << std::endl;
+      for (std::vector<AckEvent>::const_iterator it = trace.begin (); it != trace.end (); ++it)
+        {
+          out << it->segmentsAcked << " " << it->rtt.GetSeconds () << " " << it->loss << "\n";
+        }
+    }
+
+  std::cout << "Replaying " << trace.size () << " ACKs, " << iterations << " times" << std::endl;
+  std::cout << std::left << std::setw (16) << "variant"
+            << std::right << std::setw (12) << "ns/ACK"
+            << std::setw (16) << "allocs/ACK" << std::endl;
+
+  std::istringstream names (variants);
+  std::string name;
+  while (std::getline (names, name, ','))
+    {
+      TypeId tid;
+      NS_ABORT_MSG_UNLESS (TypeId::LookupByNameFailSafe ("ns3::" + name, &tid),
+                           "TypeId ns3::" << name << " not found");
+      ObjectFactory factory;
+      factory.SetTypeId (tid);
+
+      // Warm up caches and lazily-initialized state
+      Replay (factory.Create<TcpCongestionOps> (), trace, segmentSize, maxCwnd);
+
+      double bestNs = 0;
+      double allocs = 0;
+      for (uint32_t i = 0; i < iterations; ++i)
+        {
+          Ptr<TcpCongestionOps> cong = factory.Create<TcpCongestionOps> ();
+
+          uint64_t allocations = g_allocations;
+          std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now ();
+          Replay (cong, trace, segmentSize, maxCwnd);
+          std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now ();
+          allocations = g_allocations - allocations;
+
+          double ns = std::chrono::duration<double, std::nano> (end - start).count () / trace.size ();
+          if (i == 0 || ns < bestNs)
+            {
+              bestNs = ns;
+            }
+          allocs = static_cast<double> (allocations) / trace.size ();
+        }
+
+      std::cout << std::left << std::setw (16) << name
+                << std::right << std::fixed << std::setprecision (2)
+                << std::setw (12) << bestNs
+                << std::setw (16) << std::setprecision (4) << allocs << std::endl;
+    }
+
+  return 0;
+}
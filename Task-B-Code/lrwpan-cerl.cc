@@ -1,4 +1,6 @@
+#include <chrono>
 #include <fstream>
+#include <sstream>
 #include "ns3/core-module.h"
 #include "ns3/internet-module.h"
 #include "ns3/internet-apps-module.h"
@@ -20,9 +22,23 @@
 #include <ns3/propagation-delay-model.h>
 #include <ns3/single-model-spectrum-channel.h>
 #include "ns3/tcp-cerl.h"
+#include "ns3/tcp-cerl-loss-oracle.h"
+#include "scenario-csv.h"
 
 using namespace ns3;
 
+static void
+LrWpanPhyRxDrop (Ptr<TcpCerlLossOracle> oracle, Ptr<const Packet> packet)
+{
+  oracle->NotifyDrop (packet, TcpCerlLossOracle::PHY_ERROR);
+}
+
+static void
+LrWpanMacTxDrop (Ptr<TcpCerlLossOracle> oracle, Ptr<const Packet> packet)
+{
+  oracle->NotifyDrop (packet, TcpCerlLossOracle::MAC_FAILURE);
+}
+
 int main (int argc, char** argv) {
   uint16_t nNodes=30;
   uint32_t nWsnNodes; // Wireless Sensor Network
@@ -34,10 +50,29 @@ int main (int argc, char** argv) {
   uint32_t m_protocol=2;
   int nodeSpeed = 10; //in m/s
   int nodePause = 0; //in s
+  std::string flowmonFile = "";                    /* FlowMonitor XML output file (empty to disable). */
+  std::string resultsFile = "";                    /* Per-flow CSV results file, appended to (empty to disable). */
+  bool printFlows = false;                         /* Print the statistics of each flow. */
+  std::string lossOracleFile = "";                 /* Loss classification confusion matrix CSV file, appended to (empty to disable). */
+  bool timeBasedLossDetection = false;             /* RACK/TLP loss detection in the TCP senders. */
+  bool printRunTime = false;                       /* Print the wall-clock time of the simulation. */
 
   CommandLine cmd (__FILE__);
   cmd.AddValue ("dataRate", "Application data ate", dataRate);
+  cmd.AddValue ("payloadSize", "Payload size in bytes", payloadSize);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("nNodes", "Number of sensor nodes", nNodes);
+  cmd.AddValue ("nodeSpeed", "Maximum node speed in m/s", nodeSpeed);
+  cmd.AddValue ("nodePause", "Node pause time in s", nodePause);
+  cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
+  cmd.AddValue ("flowmonFile", "Write FlowMonitor statistics to this XML file", flowmonFile);
+  cmd.AddValue ("resultsFile", "Append per-flow statistics to this CSV file", resultsFile);
+  cmd.AddValue ("printFlows", "Print the statistics of each flow", printFlows);
+  cmd.AddValue ("lossOracleFile", "Score the TcpCerl loss classifications against the actual "
+                "drop causes and append the confusion matrix to this CSV file", lossOracleFile);
+  cmd.AddValue ("timeBasedLossDetection", "Detect the losses from the send times (RACK) "
+                "and probe the tail losses (TLP) instead of waiting for the RTO", timeBasedLossDetection);
+  cmd.AddValue ("printRunTime", "Print the wall-clock time of Simulator::Run", printRunTime);
   cmd.AddValue ("tcpVariant", "Transport protocol to use: TcpNewReno, "
                 "TcpHybla, TcpHighSpeed, TcpHtcp, TcpVegas, TcpScalable, TcpVeno, "
                 "TcpBic, TcpYeah, TcpIllinois, TcpWestwood,TcpCerl, TcpWestwoodPlus, TcpLedbat ", tcpVariant);
@@ -57,6 +92,7 @@ int main (int argc, char** argv) {
                       
    /* Configure TCP Options */
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
+  Config::SetDefault ("ns3::TcpSocketBase::TimeBasedLossDetection", BooleanValue (timeBasedLossDetection));
                     
   //Create nodes
   nWsnNodes = nNodes + 1;
@@ -137,6 +173,21 @@ int main (int argc, char** argv) {
   wsnDeviceInterfaces.SetForwarding (0, true);
   wsnDeviceInterfaces.SetDefaultRouteInAllNodes (0);
 
+  // Ground truth of the loss classifications
+  Ptr<TcpCerlLossOracle> oracle;
+  if (!lossOracleFile.empty ())
+    {
+      NodeContainer allNodes (wsnNodes, NodeContainer (wiredNode.Get (0)));
+      oracle = CreateObject<TcpCerlLossOracle> ();
+      oracle->Install (allNodes);
+      Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::LrWpanNetDevice/Phy/PhyRxDrop",
+                                     MakeBoundCallback (&LrWpanPhyRxDrop, oracle));
+      Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::LrWpanNetDevice/Mac/MacTxDrop",
+                                     MakeBoundCallback (&LrWpanMacTxDrop, oracle));
+      // The sockets are created when the applications start
+      Simulator::Schedule (MilliSeconds (1), &TcpCerlLossOracle::ConnectCongestionOps, oracle, wsnNodes);
+    }
+
   for (uint32_t i = 0; i < sixLowPanDevices.GetN (); i++) {
     Ptr<NetDevice> dev = sixLowPanDevices.Get (i);
     dev->SetAttribute ("UseMeshUnder", BooleanValue (true));
@@ -164,20 +215,19 @@ int main (int argc, char** argv) {
   Ptr<FlowMonitor> monitor = flowmon.InstallAll ();
 
   Simulator::Stop (Seconds (simulationTime));
+  std::chrono::steady_clock::time_point runStart = std::chrono::steady_clock::now ();
   Simulator::Run ();
+  if (printRunTime)
+    {
+      std::chrono::duration<double> runTime = std::chrono::steady_clock::now () - runStart;
+      NS_LOG_UNCOND ("Wall-clock time of the simulation: " << runTime.count () << "s");
+    }
 
   Ptr<Ipv6FlowClassifier> classifier = DynamicCast<Ipv6FlowClassifier> (flowmon.GetClassifier6 ());
   std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
 
   int count=0;
-  /*float thr=0.0,dr=0.0,lr=0.0;
-  float dl=0.0;
-  std::ofstream myfile1,myfile2,myfile3,myfile4;
-  myfile1.open ("throughput_c.txt");
-  myfile2.open ("delay_c.txt");
-  myfile3.open ("delivery-ratio_c.txt");
-  myfile4.open ("loss-ratio_c.txt");
-  */
+  std::ostringstream results;                       /* Per-flow CSV rows, written once after the run */
  
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter)
   {
@@ -188,38 +238,76 @@ int main (int argc, char** argv) {
           
           count++;
           
-          NS_LOG_UNCOND("-------------------------------------------------------------");
-          NS_LOG_UNCOND("Flow ID:" <<iter->first);
-          NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
-          NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
-          NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
-          NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
-          NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
-          NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
-          
-          /*
-          thr=iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024;
-          if(thr==-0) thr=0; 
-          dl=iter->second.delaySum.GetSeconds();
-          dr=iter->second.rxPackets*100/iter->second.txPackets ;
-          lr=(iter->second.txPackets-iter->second.rxPackets)*100/iter->second.txPackets;
-          
-          myfile1<< count<<" "<<thr<<"\n";
-          myfile2 << count<<" "<<dl<<"\n";
-          myfile3 << count<<" "<<dr<<"\n";
-          myfile4<< count<<" "<<lr<<"\n";         
-          */
+          if (printFlows)
+            {
+              NS_LOG_UNCOND("-------------------------------------------------------------");
+              NS_LOG_UNCOND("Flow ID:" <<iter->first);
+              NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
+              NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
+              NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
+              NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
+              NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
+              NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
+            }
+          if (!resultsFile.empty ())
+            {
+              double duration = iter->second.timeLastRxPacket.GetSeconds () - iter->second.timeFirstTxPacket.GetSeconds ();
+              results << "lrwpan," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+                      << "," << nNodes << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+                      << "," << iter->first << "," << t.sourceAddress << "," << t.destinationAddress
+                      << "," << t.sourcePort << "," << t.destinationPort
+                      << "," << iter->second.txPackets << "," << iter->second.rxPackets << "," << iter->second.lostPackets
+                      << "," << iter->second.txBytes << "," << iter->second.rxBytes
+                      << "," << iter->second.delaySum.GetSeconds ()
+                      << "," << iter->second.timeFirstTxPacket.GetSeconds ()
+                      << "," << iter->second.timeLastRxPacket.GetSeconds ()
+                      << "," << CsvRatio (iter->second.rxPackets * 100.0, iter->second.txPackets)
+                      << "," << CsvRatio ((static_cast<double> (iter->second.txPackets) - iter->second.rxPackets) * 100.0,
+                                          iter->second.txPackets)
+                      << "," << CsvRatio (iter->second.rxBytes * 8.0 / 1024 / 1024, duration)
+                      << "\n";
+            }
   }
-  /*
-  myfile1.close();
-  myfile2.close();
-  myfile3.close();
-  myfile4.close();
-  */
+  if (!resultsFile.empty ())
+    {
+      AppendCsv (resultsFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "flowId,sourceAddress,destinationAddress,sourcePort,destinationPort,"
+                 "txPackets,rxPackets,lostPackets,txBytes,rxBytes,delaySum,"
+                 "timeFirstTxPacket,timeLastRxPacket,deliveryRatio,lossRatio,throughput\n",
+                 results.str ());
+    }
+  if (oracle)
+    {
+      std::ostringstream matrix;
+      oracle->Print (matrix);
+      NS_LOG_UNCOND ("------------------------------------------");
+      NS_LOG_UNCOND ("Loss classifications:\n" << matrix.str ());
+
+      std::ostringstream rows;
+      for (uint32_t i = 0; i <= TcpCerlLossOracle::UNKNOWN; ++i)
+        {
+          TcpCerlLossOracle::DropCause_t cause = static_cast<TcpCerlLossOracle::DropCause_t> (i);
+          rows << "lrwpan," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+               << "," << nNodes << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+               << "," << TcpCerlLossOracle::DropCauseName[i]
+               << "," << oracle->GetCount (cause, TcpCerl::CONGESTIVE_LOSS)
+               << "," << oracle->GetCount (cause, TcpCerl::RANDOM_LOSS)
+               << "\n";
+        }
+      AppendCsv (lossOracleFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "cause,congestive,random\n",
+                 rows.str ());
+    }
   
   NS_LOG_UNCOND("------------------------------------------");
   NS_LOG_UNCOND("Total flows: " <<count);
 
+  if (!flowmonFile.empty ())
+    {
+      flowmon.SerializeToXmlFile (flowmonFile, false, false);
+    }
   Simulator::Destroy ();
 
   return 0;
@@ -0,0 +1,243 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/tcp-header.h"
+#include "ns3/tcp-cerl-loss-oracle.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TcpCerlLossOracleTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the join of the loss classifications with the segment fates
+ *
+ * The oracle is fed with synthetic events, as its traces would: segments
+ * tagged when sent, deliveries, drops, then the classifications of
+ * TcpCerl. Each classification must land in the cell of the confusion
+ * matrix given by the fate of the last copy of the segment.
+ */
+class TcpCerlLossOracleTestCase : public TestCase
+{
+public:
+  TcpCerlLossOracleTestCase ();
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * \brief Send a data segment through the oracle
+   * \param node the sender node
+   * \param port the source port
+   * \param seq the sequence number
+   * \return the tagged segment, with its TCP header
+   */
+  Ptr<Packet> Send (uint32_t node, uint16_t port, uint32_t seq);
+
+  /**
+   * \brief Deliver an ACK to the sender of a flow
+   * \param node the sender node
+   * \param port the source port of the flow
+   * \param ack the ACK number
+   */
+  void Ack (uint32_t node, uint16_t port, uint32_t ack);
+
+  /**
+   * \brief Report a loss classification to the oracle
+   * \param node the sender node
+   * \param port the source port
+   * \param seq the segment at SND.UNA
+   * \param lossClass the decision of TcpCerl
+   */
+  void Classify (uint32_t node, uint16_t port, uint32_t seq, TcpCerl::LossClass_t lossClass);
+
+  /**
+   * \brief Check a cell of the confusion matrix
+   * \param cause the actual fate of the segments
+   * \param congestive the expected count of congestive decisions
+   * \param random the expected count of random decisions
+   */
+  void CheckCount (TcpCerlLossOracle::DropCause_t cause, uint32_t congestive, uint32_t random);
+
+  Ptr<TcpCerlLossOracle> m_oracle; //!< The oracle under test
+};
+
+TcpCerlLossOracleTestCase::TcpCerlLossOracleTestCase ()
+  : TestCase ("TcpCerlLossOracle join of decisions and drops")
+{
+}
+
+Ptr<Packet>
+TcpCerlLossOracleTestCase::Send (uint32_t node, uint16_t port, uint32_t seq)
+{
+  Ptr<Packet> p = Create<Packet> (500);
+  TcpHeader header;
+  header.SetSourcePort (port);
+  header.SetDestinationPort (9);
+  header.SetSequenceNumber (SequenceNumber32 (seq));
+  p->AddHeader (header);
+
+  std::ostringstream context;
+  context << node;
+  m_oracle->TagSegment (context.str (), p);
+  return p;
+}
+
+void
+TcpCerlLossOracleTestCase::Ack (uint32_t node, uint16_t port, uint32_t ack)
+{
+  Ptr<Packet> p = Create<Packet> ();
+  TcpHeader header;
+  header.SetSourcePort (9);
+  header.SetDestinationPort (port);
+  header.SetAckNumber (SequenceNumber32 (ack));
+  header.SetFlags (TcpHeader::ACK);
+  p->AddHeader (header);
+
+  std::ostringstream context;
+  context << node;
+  m_oracle->ForgetAcked (context.str (), p);
+}
+
+void
+TcpCerlLossOracleTestCase::Classify (uint32_t node, uint16_t port, uint32_t seq,
+                                     TcpCerl::LossClass_t lossClass)
+{
+  std::ostringstream context;
+  context << node << " " << port;
+  m_oracle->LossClassified (context.str (), Simulator::Now (), lossClass,
+                            SequenceNumber32 (seq), 5000, 5000, 0, 0);
+}
+
+void
+TcpCerlLossOracleTestCase::CheckCount (TcpCerlLossOracle::DropCause_t cause,
+                                       uint32_t congestive, uint32_t random)
+{
+  NS_TEST_ASSERT_MSG_EQ (m_oracle->GetCount (cause, TcpCerl::CONGESTIVE_LOSS), congestive,
+                         "Wrong count of congestive decisions for " <<
+                         TcpCerlLossOracle::DropCauseName[cause]);
+  NS_TEST_ASSERT_MSG_EQ (m_oracle->GetCount (cause, TcpCerl::RANDOM_LOSS), random,
+                         "Wrong count of random decisions for " <<
+                         TcpCerlLossOracle::DropCauseName[cause]);
+}
+
+void
+TcpCerlLossOracleTestCase::DoRun ()
+{
+  m_oracle = CreateObject<TcpCerlLossOracle> ();
+
+  // Queue overflow, classified right
+  Ptr<Packet> p = Send (0, 49153, 1);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::QUEUE_OVERFLOW);
+  Classify (0, 49153, 1, TcpCerl::CONGESTIVE_LOSS);
+
+  // Another flow with the same sequence number is not mixed up
+  p = Send (1, 49153, 1);
+  m_oracle->RecordFate (p, TcpCerlLossOracle::NOT_LOST);
+  p = Send (0, 49154, 1);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::MAC_FAILURE);
+  Classify (0, 49153, 1, TcpCerl::RANDOM_LOSS);
+
+  // PHY error alone, then a PHY error followed by the MAC giving up:
+  // the MAC failure wins
+  p = Send (0, 49153, 501);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::PHY_ERROR);
+  Classify (0, 49153, 501, TcpCerl::RANDOM_LOSS);
+  p = Send (0, 49153, 1001);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::PHY_ERROR);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::MAC_FAILURE);
+  Classify (0, 49153, 1001, TcpCerl::CONGESTIVE_LOSS);
+
+  // Delivered: the loss detection was spurious, even after a PHY error
+  p = Send (0, 49153, 1501);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::PHY_ERROR);
+  m_oracle->RecordFate (p, TcpCerlLossOracle::NOT_LOST);
+  Classify (0, 49153, 1501, TcpCerl::CONGESTIVE_LOSS);
+
+  // Only the last copy counts: the first one overflowed a queue, the
+  // retransmission expired in a queue
+  p = Send (0, 49153, 2001);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::QUEUE_OVERFLOW);
+  p = Send (0, 49153, 2001);
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::QUEUE_EXPIRED);
+  Classify (0, 49153, 2001, TcpCerl::CONGESTIVE_LOSS);
+
+  // Two segments aggregated in one frame, dropped by IP
+  p = Send (0, 49153, 2501);
+  p->AddAtEnd (Send (0, 49153, 3001));
+  m_oracle->NotifyDrop (p, TcpCerlLossOracle::ROUTING);
+  Classify (0, 49153, 2501, TcpCerl::RANDOM_LOSS);
+  Classify (0, 49153, 3001, TcpCerl::RANDOM_LOSS);
+
+  // A copy with no recorded fate, and a segment never seen
+  Send (0, 49153, 3501);
+  Classify (0, 49153, 3501, TcpCerl::CONGESTIVE_LOSS);
+  Classify (2, 49153, 1, TcpCerl::RANDOM_LOSS);
+
+  CheckCount (TcpCerlLossOracle::QUEUE_OVERFLOW, 1, 1);
+  CheckCount (TcpCerlLossOracle::QUEUE_EXPIRED, 1, 0);
+  CheckCount (TcpCerlLossOracle::PHY_ERROR, 0, 1);
+  CheckCount (TcpCerlLossOracle::MAC_FAILURE, 1, 0);
+  CheckCount (TcpCerlLossOracle::ROUTING, 0, 2);
+  CheckCount (TcpCerlLossOracle::NOT_LOST, 1, 0);
+  CheckCount (TcpCerlLossOracle::UNKNOWN, 1, 1);
+
+  // An ACK delivered to the sender forgets the segments below it, and only
+  // those of its flow
+  NS_TEST_ASSERT_MSG_EQ (m_oracle->m_segments.size (), 10u, "Wrong number of segments recorded");
+  Ack (0, 49153, 3001);
+  NS_TEST_ASSERT_MSG_EQ (m_oracle->m_segments.size (), 4u, "Acknowledged segments not forgotten");
+  Classify (0, 49153, 3001, TcpCerl::RANDOM_LOSS);
+  CheckCount (TcpCerlLossOracle::ROUTING, 0, 3);
+  Ack (0, 49154, 501);
+  Ack (1, 49153, 501);
+  NS_TEST_ASSERT_MSG_EQ (m_oracle->m_segments.size (), 2u, "Acknowledged segments not forgotten");
+}
+
+void
+TcpCerlLossOracleTestCase::DoTeardown ()
+{
+  m_oracle = 0;
+  Simulator::Destroy ();
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the ground truth of the TcpCerl loss classifications
+ */
+class TcpCerlLossOracleTestSuite : public TestSuite
+{
+public:
+  TcpCerlLossOracleTestSuite ()
+    : TestSuite ("tcp-cerl-loss-oracle", UNIT)
+  {
+    AddTestCase (new TcpCerlLossOracleTestCase, TestCase::QUICK);
+  }
+};
+
+static TcpCerlLossOracleTestSuite g_tcpCerlLossOracleTestSuite; //!< Static variable for test initialization
+
+} // namespace ns3
@@ -0,0 +1,496 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <iomanip>
+#include <sstream>
+#include "tcp-cerl-loss-oracle.h"
+#include "tcp-header.h"
+#include "tcp-l4-protocol.h"
+#include "tcp-socket-base.h"
+#include "ns3/log.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/inet6-socket-address.h"
+#include "ns3/tag.h"
+#include "ns3/pointer.h"
+#include "ns3/object-vector.h"
+#include "ns3/queue-disc.h"
+#include "ns3/traffic-control-layer.h"
+
+namespace ns3 {
+
+NS_LOG_COMPONENT_DEFINE ("TcpCerlLossOracle");
+NS_OBJECT_ENSURE_REGISTERED (TcpCerlLossOracle);
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Byte tag identifying the TCP segment carried by a packet
+ */
+class TcpCerlLossOracleTag : public Tag
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+  virtual TypeId GetInstanceTypeId (void) const;
+  virtual uint32_t GetSerializedSize (void) const;
+  virtual void Serialize (TagBuffer i) const;
+  virtual void Deserialize (TagBuffer i);
+  virtual void Print (std::ostream &os) const;
+
+  uint32_t m_node;   //!< Sender node
+  uint16_t m_port;   //!< Source port
+  uint32_t m_seq;    //!< Sequence number
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TcpCerlLossOracleTag);
+
+TypeId
+TcpCerlLossOracleTag::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpCerlLossOracleTag")
+    .SetParent<Tag> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<TcpCerlLossOracleTag> ()
+  ;
+  return tid;
+}
+
+TypeId
+TcpCerlLossOracleTag::GetInstanceTypeId (void) const
+{
+  return GetTypeId ();
+}
+
+uint32_t
+TcpCerlLossOracleTag::GetSerializedSize (void) const
+{
+  return 10;
+}
+
+void
+TcpCerlLossOracleTag::Serialize (TagBuffer i) const
+{
+  i.WriteU32 (m_node);
+  i.WriteU16 (m_port);
+  i.WriteU32 (m_seq);
+}
+
+void
+TcpCerlLossOracleTag::Deserialize (TagBuffer i)
+{
+  m_node = i.ReadU32 ();
+  m_port = i.ReadU16 ();
+  m_seq = i.ReadU32 ();
+}
+
+void
+TcpCerlLossOracleTag::Print (std::ostream &os) const
+{
+  os << "node=" << m_node << " port=" << m_port << " seq=" << m_seq;
+}
+
+const char* const
+TcpCerlLossOracle::DropCauseName[TcpCerlLossOracle::UNKNOWN + 1] =
+{
+  "QUEUE_OVERFLOW", "QUEUE_EXPIRED", "PHY_ERROR", "MAC_FAILURE", "ROUTING", "NOT_LOST", "UNKNOWN"
+};
+
+bool
+TcpCerlLossOracle::SegmentId::operator< (const SegmentId &other) const
+{
+  if (node != other.node)
+    {
+      return node < other.node;
+    }
+  if (port != other.port)
+    {
+      return port < other.port;
+    }
+  return seq < other.seq;
+}
+
+TypeId
+TcpCerlLossOracle::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpCerlLossOracle")
+    .SetParent<Object> ()
+    .SetGroupName ("Internet")
+    .AddConstructor<TcpCerlLossOracle> ()
+  ;
+  return tid;
+}
+
+TcpCerlLossOracle::TcpCerlLossOracle ()
+{
+  NS_LOG_FUNCTION (this);
+  for (uint32_t i = 0; i <= UNKNOWN; ++i)
+    {
+      for (uint32_t j = 0; j <= TcpCerl::RANDOM_LOSS; ++j)
+        {
+          m_matrix[i][j] = 0;
+        }
+    }
+}
+
+TcpCerlLossOracle::~TcpCerlLossOracle ()
+{
+  NS_LOG_FUNCTION (this);
+}
+
+void
+TcpCerlLossOracle::Install (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      Ptr<Node> node = *it;
+      std::ostringstream context;
+      context << node->GetId ();
+
+      Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol> ();
+      if (ipv4)
+        {
+          ipv4->TraceConnect ("SendOutgoing", context.str (),
+                              MakeCallback (&TcpCerlLossOracle::Ipv4SendOutgoing, this));
+          ipv4->TraceConnect ("LocalDeliver", context.str (),
+                              MakeCallback (&TcpCerlLossOracle::Ipv4LocalDeliver, this));
+          ipv4->TraceConnectWithoutContext ("Drop",
+                                            MakeCallback (&TcpCerlLossOracle::Ipv4Drop, this));
+        }
+
+      Ptr<Ipv6L3Protocol> ipv6 = node->GetObject<Ipv6L3Protocol> ();
+      if (ipv6)
+        {
+          ipv6->TraceConnect ("SendOutgoing", context.str (),
+                              MakeCallback (&TcpCerlLossOracle::Ipv6SendOutgoing, this));
+          ipv6->TraceConnect ("LocalDeliver", context.str (),
+                              MakeCallback (&TcpCerlLossOracle::Ipv6LocalDeliver, this));
+          ipv6->TraceConnectWithoutContext ("Drop",
+                                            MakeCallback (&TcpCerlLossOracle::Ipv6Drop, this));
+        }
+
+      Ptr<TrafficControlLayer> tc = node->GetObject<TrafficControlLayer> ();
+      if (tc)
+        {
+          for (uint32_t i = 0; i < node->GetNDevices (); ++i)
+            {
+              Ptr<QueueDisc> qd = tc->GetRootQueueDiscOnDevice (node->GetDevice (i));
+              if (qd)
+                {
+                  qd->TraceConnectWithoutContext ("Drop",
+                                                  MakeCallback (&TcpCerlLossOracle::QueueDiscDrop, this));
+                }
+            }
+        }
+    }
+}
+
+void
+TcpCerlLossOracle::ConnectCongestionOps (NodeContainer nodes)
+{
+  NS_LOG_FUNCTION (this);
+
+  for (NodeContainer::Iterator it = nodes.Begin (); it != nodes.End (); ++it)
+    {
+      Ptr<Node> node = *it;
+      Ptr<TcpL4Protocol> tcp = node->GetObject<TcpL4Protocol> ();
+      if (!tcp)
+        {
+          continue;
+        }
+
+      ObjectVectorValue sockets;
+      tcp->GetAttribute ("SocketList", sockets);
+      for (ObjectVectorValue::Iterator s = sockets.Begin (); s != sockets.End (); ++s)
+        {
+          Ptr<TcpSocketBase> socket = DynamicCast<TcpSocketBase> (s->second);
+          if (!socket)
+            {
+              continue;
+            }
+          PointerValue ops;
+          socket->GetAttribute ("CongestionOps", ops);
+          Ptr<TcpCerl> cerl = ops.Get<TcpCerl> ();
+          if (!cerl || m_connected.find (cerl) != m_connected.end ())
+            {
+              continue;
+            }
+
+          Address local;
+          if (socket->GetSockName (local) != 0)
+            {
+              continue;
+            }
+          uint16_t port;
+          if (InetSocketAddress::IsMatchingType (local))
+            {
+              port = InetSocketAddress::ConvertFrom (local).GetPort ();
+            }
+          else if (Inet6SocketAddress::IsMatchingType (local))
+            {
+              port = Inet6SocketAddress::ConvertFrom (local).GetPort ();
+            }
+          else
+            {
+              continue;
+            }
+
+          std::ostringstream context;
+          context << node->GetId () << " " << port;
+          cerl->TraceConnect ("LossClassification", context.str (),
+                              MakeCallback (&TcpCerlLossOracle::LossClassified, this));
+          m_connected.insert (cerl);
+          NS_LOG_LOGIC ("Tracing the loss classifications of node " << node->GetId () <<
+                        " port " << port);
+        }
+    }
+}
+
+void
+TcpCerlLossOracle::Ipv4SendOutgoing (std::string context, const Ipv4Header &header,
+                                     Ptr<const Packet> p, uint32_t iface)
+{
+  if (header.GetProtocol () == TcpL4Protocol::PROT_NUMBER)
+    {
+      TagSegment (context, p);
+    }
+}
+
+void
+TcpCerlLossOracle::Ipv6SendOutgoing (std::string context, const Ipv6Header &header,
+                                     Ptr<const Packet> p, uint32_t iface)
+{
+  if (header.GetNextHeader () == TcpL4Protocol::PROT_NUMBER)
+    {
+      TagSegment (context, p);
+    }
+}
+
+void
+TcpCerlLossOracle::TagSegment (const std::string &context, Ptr<const Packet> p)
+{
+  TcpHeader tcpHeader;
+  p->PeekHeader (tcpHeader);
+  if (p->GetSize () <= tcpHeader.GetSerializedSize ())
+    {
+      // Pure ACKs and control segments are not retransmitted on a loss
+      return;
+    }
+
+  TcpCerlLossOracleTag tag;
+  std::istringstream (context) >> tag.m_node;
+  tag.m_port = tcpHeader.GetSourcePort ();
+  tag.m_seq = tcpHeader.GetSequenceNumber ().GetValue ();
+  p->AddByteTag (tag);
+
+  // A new copy of the segment: forget what happened to the previous ones
+  SegmentId id = { tag.m_node, tag.m_port, tcpHeader.GetSequenceNumber () };
+  SegmentFate fate = { false, UNKNOWN, false };
+  m_segments[id] = fate;
+}
+
+void
+TcpCerlLossOracle::Ipv4LocalDeliver (std::string context, const Ipv4Header &header,
+                                     Ptr<const Packet> p, uint32_t iface)
+{
+  RecordFate (p, NOT_LOST);
+  if (header.GetProtocol () == TcpL4Protocol::PROT_NUMBER)
+    {
+      ForgetAcked (context, p);
+    }
+}
+
+void
+TcpCerlLossOracle::Ipv6LocalDeliver (std::string context, const Ipv6Header &header,
+                                     Ptr<const Packet> p, uint32_t iface)
+{
+  RecordFate (p, NOT_LOST);
+  if (header.GetNextHeader () == TcpL4Protocol::PROT_NUMBER)
+    {
+      ForgetAcked (context, p);
+    }
+}
+
+void
+TcpCerlLossOracle::ForgetAcked (const std::string &context, Ptr<const Packet> p)
+{
+  TcpHeader tcpHeader;
+  p->PeekHeader (tcpHeader);
+  if ((tcpHeader.GetFlags () & TcpHeader::ACK) == 0)
+    {
+      return;
+    }
+
+  // The segments of a flow are contiguous in the map: the ones sorting
+  // before the ACK number are acknowledged, and are never classified
+  SegmentId id;
+  std::istringstream (context) >> id.node;
+  id.port = tcpHeader.GetDestinationPort ();
+  id.seq = tcpHeader.GetAckNumber ();
+
+  std::map<SegmentId, SegmentFate>::iterator it = m_segments.lower_bound (id);
+  while (it != m_segments.begin ())
+    {
+      std::map<SegmentId, SegmentFate>::iterator prev = it;
+      --prev;
+      if (prev->first.node != id.node || prev->first.port != id.port)
+        {
+          break;
+        }
+      m_segments.erase (prev);
+    }
+}
+
+void
+TcpCerlLossOracle::Ipv4Drop (const Ipv4Header &header, Ptr<const Packet> p,
+                             Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t iface)
+{
+  switch (reason)
+    {
+    case Ipv4L3Protocol::DROP_BAD_CHECKSUM:
+      NotifyDrop (p, PHY_ERROR);
+      break;
+    case Ipv4L3Protocol::DROP_FRAGMENT_TIMEOUT:
+      // The missing fragment was dropped (and recorded) elsewhere
+      break;
+    default:
+      NotifyDrop (p, ROUTING);
+      break;
+    }
+}
+
+void
+TcpCerlLossOracle::Ipv6Drop (const Ipv6Header &header, Ptr<const Packet> p,
+                             Ipv6L3Protocol::DropReason reason, Ptr<Ipv6> ipv6, uint32_t iface)
+{
+  if (reason != Ipv6L3Protocol::DROP_FRAGMENT_TIMEOUT)
+    {
+      NotifyDrop (p, ROUTING);
+    }
+}
+
+void
+TcpCerlLossOracle::QueueDiscDrop (Ptr<const QueueDiscItem> item)
+{
+  NotifyDrop (item->GetPacket (), QUEUE_OVERFLOW);
+}
+
+void
+TcpCerlLossOracle::NotifyDrop (Ptr<const Packet> p, DropCause_t cause)
+{
+  NS_ASSERT_MSG (cause != NOT_LOST && cause != UNKNOWN, "Not a drop cause");
+  RecordFate (p, cause);
+}
+
+void
+TcpCerlLossOracle::RecordFate (Ptr<const Packet> p, DropCause_t cause)
+{
+  ByteTagIterator it = p->GetByteTagIterator ();
+  while (it.HasNext ())
+    {
+      ByteTagIterator::Item item = it.Next ();
+      if (item.GetTypeId () != TcpCerlLossOracleTag::GetTypeId ())
+        {
+          continue;
+        }
+      TcpCerlLossOracleTag tag;
+      item.GetTag (tag);
+
+      SegmentId id = { tag.m_node, tag.m_port, SequenceNumber32 (tag.m_seq) };
+      std::map<SegmentId, SegmentFate>::iterator fate = m_segments.find (id);
+      if (fate == m_segments.end ())
+        {
+          continue;
+        }
+
+      NS_LOG_LOGIC (DropCauseName[cause] << " node " << tag.m_node <<
+                    " port " << tag.m_port << " seq " << tag.m_seq);
+      if (cause == NOT_LOST)
+        {
+          fate->second.delivered = true;
+        }
+      else if (cause == PHY_ERROR)
+        {
+          fate->second.phyError = true;
+        }
+      else
+        {
+          fate->second.drop = cause;
+        }
+    }
+}
+
+void
+TcpCerlLossOracle::LossClassified (std::string context, Time now,
+                                   TcpCerl::LossClass_t lossClass, SequenceNumber32 sndUna,
+                                   uint32_t cWnd, uint32_t bytesInFlight,
+                                   uint32_t qlength, uint32_t dqlt)
+{
+  SegmentId id;
+  std::istringstream (context) >> id.node >> id.port;
+  id.seq = sndUna;
+
+  DropCause_t cause = UNKNOWN;
+  std::map<SegmentId, SegmentFate>::const_iterator fate = m_segments.find (id);
+  if (fate != m_segments.end ())
+    {
+      if (fate->second.delivered)
+        {
+          cause = NOT_LOST;
+        }
+      else if (fate->second.drop != UNKNOWN)
+        {
+          cause = fate->second.drop;
+        }
+      else if (fate->second.phyError)
+        {
+          cause = PHY_ERROR;
+        }
+    }
+
+  NS_LOG_DEBUG ("Node " << id.node << " port " << id.port << " seq " << sndUna <<
+                " classified " << TcpCerl::LossClassName[lossClass] <<
+                " (qlength " << qlength << ", dqlt " << dqlt << "), actual " <<
+                DropCauseName[cause]);
+  m_matrix[cause][lossClass]++;
+}
+
+uint32_t
+TcpCerlLossOracle::GetCount (DropCause_t cause, TcpCerl::LossClass_t lossClass) const
+{
+  return m_matrix[cause][lossClass];
+}
+
+void
+TcpCerlLossOracle::Print (std::ostream &os) const
+{
+  os << std::left << std::setw (16) << "actual"
+     << std::right << std::setw (12) << "congestive"
+     << std::setw (12) << "random" << std::endl;
+  for (uint32_t i = 0; i <= UNKNOWN; ++i)
+    {
+      os << std::left << std::setw (16) << DropCauseName[i]
+         << std::right << std::setw (12) << m_matrix[i][TcpCerl::CONGESTIVE_LOSS]
+         << std::setw (12) << m_matrix[i][TcpCerl::RANDOM_LOSS] << std::endl;
+    }
+}
+
+} // namespace ns3
@@ -0,0 +1,292 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef TCP_CERL_LOSS_ORACLE_H
+#define TCP_CERL_LOSS_ORACLE_H
+
+#include <map>
+#include <ostream>
+#include <set>
+#include "ns3/object.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/node-container.h"
+#include "ns3/sequence-number.h"
+#include "ipv4-l3-protocol.h"
+#include "ipv6-l3-protocol.h"
+#include "tcp-cerl.h"
+
+namespace ns3 {
+
+class QueueDiscItem;
+
+/**
+ * \ingroup congestionOps
+ *
+ * \brief Ground truth for the loss classification of TcpCerl
+ *
+ * Every TCP data segment leaving the IP layer of a node is marked with a
+ * byte tag carrying the sender node, the source port and the sequence
+ * number of the segment. The tag survives the lower layers (headers,
+ * fragmentation, aggregation), so that the drop points can report the
+ * segments they discard together with the reason of the drop:
+ *
+ * - queue overflow, in the queue discs and in the device queues;
+ * - queue expiry, when a device queue drops a frame that waited longer
+ *   than its lifetime;
+ * - PHY error, when the error model corrupts a frame;
+ * - MAC failure, when the MAC gives up on a frame (retry limit, channel
+ *   access failure);
+ * - routing, when IP has no route or the TTL expires.
+ *
+ * The IP drops, the queue disc drops and the local deliveries are traced
+ * by Install (); the device-specific drop points (which depend on the
+ * technology of the scenario) are connected by the user to NotifyDrop ().
+ *
+ * Each TcpCerl loss classification is then joined with the fate of the
+ * copy of the segment at SND.UNA sent last: if the copy was delivered the
+ * loss was spurious (NOT_LOST); otherwise the cause is the last queue,
+ * MAC or routing drop of the copy. PHY errors are only used when none of
+ * these was recorded, as a corrupted frame is usually retransmitted by
+ * the MAC (and may be overheard by nodes that are not the receiver). The
+ * result is a confusion matrix between the actual cause and the decision.
+ *
+ * The fate of a segment is forgotten once an ACK above it is delivered to
+ * its sender, so that the memory used is bounded by the data in flight.
+ */
+class TcpCerlLossOracle : public Object
+{
+public:
+  /**
+   * \brief Actual fate of a segment considered lost by TCP
+   */
+  typedef enum
+  {
+    QUEUE_OVERFLOW,  /**< Dropped by a queue: congestive loss */
+    QUEUE_EXPIRED,   /**< Dropped by a queue after waiting longer than its lifetime */
+    PHY_ERROR,       /**< Corrupted by the channel: random loss */
+    MAC_FAILURE,     /**< Dropped by the MAC after retries or channel access failures */
+    ROUTING,         /**< Dropped by IP: no route, route error or TTL expired */
+    NOT_LOST,        /**< Delivered to the receiver: spurious loss detection */
+    UNKNOWN          /**< No drop recorded */
+  } DropCause_t;
+
+  /**
+   * \brief Literal names of the drop causes, for use in reports
+   */
+  static const char* const DropCauseName[UNKNOWN + 1];
+
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  TcpCerlLossOracle ();
+  virtual ~TcpCerlLossOracle ();
+
+  /**
+   * \brief TcpCerlLossOracleTestCase friend class (for tests).
+   * \relates TcpCerlLossOracleTestCase
+   */
+  friend class TcpCerlLossOracleTestCase;
+
+  /**
+   * \brief Trace the IP layer and the queue discs of the nodes
+   *
+   * Must be called once the addresses are assigned, as the queue discs
+   * are installed at that time.
+   *
+   * \param nodes the nodes to trace
+   */
+  void Install (NodeContainer nodes);
+
+  /**
+   * \brief Trace the loss classifications of the TcpCerl sockets of the nodes
+   *
+   * Only the sockets existing at the time of the call are connected, so it
+   * should be scheduled right after the start of the applications. It can
+   * be called several times: sockets already connected are skipped.
+   *
+   * \param nodes the nodes to trace
+   */
+  void ConnectCongestionOps (NodeContainer nodes);
+
+  /**
+   * \brief Record the drop of the segments carried by a packet
+   *
+   * \param p the dropped packet (or frame)
+   * \param cause the reason of the drop
+   */
+  void NotifyDrop (Ptr<const Packet> p, DropCause_t cause);
+
+  /**
+   * \brief Get the number of classifications with a given outcome
+   *
+   * \param cause the actual fate of the segment
+   * \param lossClass the decision of TcpCerl
+   * \return the number of decisions
+   */
+  uint32_t GetCount (DropCause_t cause, TcpCerl::LossClass_t lossClass) const;
+
+  /**
+   * \brief Print the confusion matrix
+   *
+   * \param os the output stream
+   */
+  void Print (std::ostream &os) const;
+
+private:
+  /**
+   * \brief Identifier of a TCP segment
+   */
+  struct SegmentId
+  {
+    uint32_t node;          //!< Sender node
+    uint16_t port;          //!< Source port
+    SequenceNumber32 seq;   //!< Sequence number
+
+    /**
+     * \brief Comparison operator, for use in a map
+     * \param other the other segment
+     * \return true if this segment sorts before the other
+     */
+    bool operator< (const SegmentId &other) const;
+  };
+
+  /**
+   * \brief What happened to the last copy of a segment
+   */
+  struct SegmentFate
+  {
+    bool delivered;         //!< The copy reached the destination
+    DropCause_t drop;       //!< Last queue, MAC or routing drop, UNKNOWN if none
+    bool phyError;          //!< The copy was corrupted at least once
+  };
+
+  /**
+   * \brief Tag the TCP data segments sent by IPv4
+   * \param context the sender node id
+   * \param header the IPv4 header
+   * \param p the segment
+   * \param iface the output interface
+   */
+  void Ipv4SendOutgoing (std::string context, const Ipv4Header &header,
+                         Ptr<const Packet> p, uint32_t iface);
+
+  /**
+   * \brief Tag the TCP data segments sent by IPv6
+   * \param context the sender node id
+   * \param header the IPv6 header
+   * \param p the segment
+   * \param iface the output interface
+   */
+  void Ipv6SendOutgoing (std::string context, const Ipv6Header &header,
+                         Ptr<const Packet> p, uint32_t iface);
+
+  /**
+   * \brief Tag a TCP data segment
+   * \param context the sender node id
+   * \param p the segment, starting with the TCP header
+   */
+  void TagSegment (const std::string &context, Ptr<const Packet> p);
+
+  /**
+   * \brief Record the segments and the ACKs delivered by IPv4
+   * \param context the receiver node id
+   * \param header the IPv4 header
+   * \param p the packet
+   * \param iface the input interface
+   */
+  void Ipv4LocalDeliver (std::string context, const Ipv4Header &header,
+                         Ptr<const Packet> p, uint32_t iface);
+
+  /**
+   * \brief Record the segments and the ACKs delivered by IPv6
+   * \param context the receiver node id
+   * \param header the IPv6 header
+   * \param p the packet
+   * \param iface the input interface
+   */
+  void Ipv6LocalDeliver (std::string context, const Ipv6Header &header,
+                         Ptr<const Packet> p, uint32_t iface);
+
+  /**
+   * \brief Forget the segments acknowledged by an ACK delivered to their sender
+   * \param context the receiver node id, which sent the acknowledged segments
+   * \param p the packet, starting with the TCP header
+   */
+  void ForgetAcked (const std::string &context, Ptr<const Packet> p);
+
+  /**
+   * \brief Record the fate of the segments carried by a packet
+   * \param p the packet (or frame)
+   * \param cause NOT_LOST for a delivery, the reason of the drop otherwise
+   */
+  void RecordFate (Ptr<const Packet> p, DropCause_t cause);
+
+  /**
+   * \brief Record the segments dropped by IPv4
+   * \param header the IPv4 header
+   * \param p the packet
+   * \param reason the reason of the drop
+   * \param ipv4 the IPv4 protocol
+   * \param iface the interface
+   */
+  void Ipv4Drop (const Ipv4Header &header, Ptr<const Packet> p,
+                 Ipv4L3Protocol::DropReason reason, Ptr<Ipv4> ipv4, uint32_t iface);
+
+  /**
+   * \brief Record the segments dropped by IPv6
+   * \param header the IPv6 header
+   * \param p the packet
+   * \param reason the reason of the drop
+   * \param ipv6 the IPv6 protocol
+   * \param iface the interface
+   */
+  void Ipv6Drop (const Ipv6Header &header, Ptr<const Packet> p,
+                 Ipv6L3Protocol::DropReason reason, Ptr<Ipv6> ipv6, uint32_t iface);
+
+  /**
+   * \brief Record the segments dropped by a queue disc
+   * \param item the dropped item
+   */
+  void QueueDiscDrop (Ptr<const QueueDiscItem> item);
+
+  /**
+   * \brief Join a loss classification with the fate of the segment
+   * \param context the sender node id and source port
+   * \param now the time of the decision
+   * \param lossClass the decision
+   * \param sndUna the segment considered lost
+   * \param cWnd the congestion window
+   * \param bytesInFlight the bytes in flight
+   * \param qlength the estimated backlog
+   * \param dqlt the threshold for congestion detection
+   */
+  void LossClassified (std::string context, Time now, TcpCerl::LossClass_t lossClass,
+                       SequenceNumber32 sndUna, uint32_t cWnd, uint32_t bytesInFlight,
+                       uint32_t qlength, uint32_t dqlt);
+
+  std::map<SegmentId, SegmentFate> m_segments;   //!< Fate of the last copy of each segment
+  std::set<Ptr<TcpCerl> > m_connected;           //!< Congestion controls already traced
+  uint32_t m_matrix[UNKNOWN + 1][TcpCerl::RANDOM_LOSS + 1]; //!< Confusion matrix
+};
+
+} // namespace ns3
+
+#endif // TCP_CERL_LOSS_ORACLE_H
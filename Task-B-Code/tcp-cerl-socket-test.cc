@@ -0,0 +1,442 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "tcp-general-test.h"
+#include "tcp-error-model.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/tcp-cerl.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TcpCerlSocketTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the ssThresh of TcpCerl on an RTO within a congestion episode
+ *
+ * Without a bottleneck queue the backlog estimate is zero, so every loss is
+ * congestive. A segment is lost, and so is its fast retransmission: the
+ * RTO fires in the same window of data as the first reduction. As in
+ * Linux, the RTO does not reduce ssThresh a second time in the episode,
+ * and cWnd restarts from one segment.
+ */
+class TcpCerlRtoTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param desc test description
+   */
+  TcpCerlRtoTest (const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                               const TcpSocketState::TcpCongState_t newValue);
+  virtual void BeforeRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_recovered;            //!< Fast recovery entered before the RTO
+  bool m_rtoExpired;           //!< The RTO fired
+  uint32_t m_ssThreshRecovery; //!< ssThresh set by the fast recovery
+};
+
+TcpCerlRtoTest::TcpCerlRtoTest (const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_recovered (false),
+    m_rtoExpired (false),
+    m_ssThreshRecovery (0)
+{
+}
+
+void
+TcpCerlRtoTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (40);
+  SetAppPktSize (500);
+  SetAppPktInterval (MilliSeconds (1));
+  SetPropagationDelay (MilliSeconds (10));
+  SetCongestionControl (TcpCerl::GetTypeId ());
+}
+
+void
+TcpCerlRtoTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 10);
+}
+
+Ptr<ErrorModel>
+TcpCerlRtoTest::CreateReceiverErrorModel ()
+{
+  // The segment is dropped twice: the original and the fast retransmission
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (4001));
+  errorModel->AddSeqToKill (SequenceNumber32 (4001));
+  return errorModel;
+}
+
+void
+TcpCerlRtoTest::CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                                const TcpSocketState::TcpCongState_t newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+  if (newValue == TcpSocketState::CA_RECOVERY && !m_rtoExpired)
+    {
+      m_recovered = true;
+    }
+}
+
+void
+TcpCerlRtoTest::BeforeRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who == SENDER && !m_rtoExpired)
+    {
+      m_ssThreshRecovery = tcb->m_ssThresh;
+    }
+}
+
+void
+TcpCerlRtoTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who != SENDER || m_rtoExpired)
+    {
+      return;
+    }
+  m_rtoExpired = true;
+
+  NS_TEST_ASSERT_MSG_EQ (m_recovered, true, "No fast recovery before the RTO");
+  NS_TEST_ASSERT_MSG_EQ (tcb->m_ssThresh.Get (), m_ssThreshRecovery,
+                         "ssThresh reduced twice in the same episode");
+  NS_TEST_ASSERT_MSG_EQ (tcb->m_cWnd.Get (), tcb->m_segmentSize,
+                         "cWnd not restarted from one segment");
+}
+
+void
+TcpCerlRtoTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, true, "The lost retransmission did not cause an RTO");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TcpCerl that classifies every loss as random
+ */
+class TcpCerlRandomLoss : public TcpCerl
+{
+public:
+  /**
+   * \brief Get the type ID.
+   * \return the object TypeId
+   */
+  static TypeId GetTypeId (void);
+
+  TcpCerlRandomLoss ()
+    : TcpCerl ()
+  {
+  }
+
+  /**
+   * \brief Copy constructor
+   * \param sock the object to copy
+   */
+  TcpCerlRandomLoss (const TcpCerlRandomLoss &sock)
+    : TcpCerl (sock)
+  {
+  }
+
+  virtual LossResponse GetLossResponse (Ptr<const TcpSocketState> tcb,
+                                        uint32_t bytesInFlight)
+  {
+    LossResponse response;
+    response.ssThresh = std::max (bytesInFlight, 2 * tcb->m_segmentSize);
+    response.keepCwnd = true;
+    return response;
+  }
+
+  virtual Ptr<TcpCongestionOps> Fork ()
+  {
+    return CopyObject<TcpCerlRandomLoss> (this);
+  }
+};
+
+NS_OBJECT_ENSURE_REGISTERED (TcpCerlRandomLoss);
+
+TypeId
+TcpCerlRandomLoss::GetTypeId (void)
+{
+  static TypeId tid = TypeId ("ns3::TcpCerlRandomLoss")
+    .SetParent<TcpCerl> ()
+    .AddConstructor<TcpCerlRandomLoss> ()
+    .SetGroupName ("Internet")
+  ;
+  return tid;
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing that a random loss does not deflate the window
+ *
+ * One segment is lost and every loss is classified as random: the fast
+ * recovery retransmits it without the recovery algorithm, so cWnd never
+ * decreases, neither when the recovery starts nor when it ends.
+ */
+class TcpCerlRandomLossTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param desc test description
+   */
+  TcpCerlRandomLossTest (const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void CWndTrace (uint32_t oldValue, uint32_t newValue);
+  virtual void CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                               const TcpSocketState::TcpCongState_t newValue);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_recovered;         //!< Fast recovery entered
+  bool m_exited;            //!< Fast recovery exited
+  uint32_t m_cWndRecovery;  //!< cWnd when the fast recovery started
+};
+
+TcpCerlRandomLossTest::TcpCerlRandomLossTest (const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_recovered (false),
+    m_exited (false),
+    m_cWndRecovery (0)
+{
+}
+
+void
+TcpCerlRandomLossTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (40);
+  SetAppPktSize (500);
+  SetAppPktInterval (MilliSeconds (1));
+  SetPropagationDelay (MilliSeconds (10));
+  SetCongestionControl (TcpCerlRandomLoss::GetTypeId ());
+}
+
+void
+TcpCerlRandomLossTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 10);
+}
+
+Ptr<ErrorModel>
+TcpCerlRandomLossTest::CreateReceiverErrorModel ()
+{
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (4001));
+  return errorModel;
+}
+
+void
+TcpCerlRandomLossTest::CWndTrace (uint32_t oldValue, uint32_t newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (newValue, oldValue, "cWnd deflated after a random loss");
+}
+
+void
+TcpCerlRandomLossTest::CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                                       const TcpSocketState::TcpCongState_t newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+  if (newValue == TcpSocketState::CA_RECOVERY)
+    {
+      m_recovered = true;
+      m_cWndRecovery = GetCwnd (SENDER);
+    }
+  else if (oldValue == TcpSocketState::CA_RECOVERY)
+    {
+      m_exited = true;
+      NS_TEST_ASSERT_MSG_GT_OR_EQ (GetCwnd (SENDER), m_cWndRecovery,
+                                   "cWnd deflated by the fast recovery");
+    }
+}
+
+void
+TcpCerlRandomLossTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  NS_TEST_ASSERT_MSG_EQ (true, false, "RTO not expected after a single loss");
+}
+
+void
+TcpCerlRandomLossTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_recovered, true, "Fast recovery not entered");
+  NS_TEST_ASSERT_MSG_EQ (m_exited, true, "Fast recovery not exited");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the window after an RTO classified as random
+ *
+ * Every loss is classified as random, as with a backlog below the
+ * threshold. A segment is lost along with its fast retransmission, so the
+ * RTO fires during the fast recovery. The loss response of the RTO sets
+ * ssThresh to the bytes in flight, and cWnd restarts from half of it in
+ * whole segments instead of from one segment.
+ */
+class TcpCerlRandomRtoTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param desc test description
+   */
+  TcpCerlRandomRtoTest (const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void BeforeRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_rtoExpired;      //!< The RTO fired
+  uint32_t m_cWndBefore;  //!< cWnd when the RTO fired
+};
+
+TcpCerlRandomRtoTest::TcpCerlRandomRtoTest (const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_rtoExpired (false),
+    m_cWndBefore (0)
+{
+}
+
+void
+TcpCerlRandomRtoTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (40);
+  SetAppPktSize (500);
+  SetAppPktInterval (MilliSeconds (1));
+  SetPropagationDelay (MilliSeconds (10));
+  SetCongestionControl (TcpCerlRandomLoss::GetTypeId ());
+}
+
+void
+TcpCerlRandomRtoTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 10);
+}
+
+Ptr<ErrorModel>
+TcpCerlRandomRtoTest::CreateReceiverErrorModel ()
+{
+  // The segment is dropped twice: the original and the fast retransmission
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (4001));
+  errorModel->AddSeqToKill (SequenceNumber32 (4001));
+  return errorModel;
+}
+
+void
+TcpCerlRandomRtoTest::BeforeRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who == SENDER && !m_rtoExpired)
+    {
+      m_cWndBefore = tcb->m_cWnd;
+    }
+}
+
+void
+TcpCerlRandomRtoTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who != SENDER || m_rtoExpired)
+    {
+      return;
+    }
+  m_rtoExpired = true;
+
+  uint32_t segmentSize = tcb->m_segmentSize;
+  uint32_t ssThresh = tcb->m_ssThresh;
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (ssThresh, 2 * segmentSize, "ssThresh below two segments");
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (ssThresh, m_cWndBefore,
+                               "ssThresh above the window of the random loss");
+  NS_TEST_ASSERT_MSG_EQ (tcb->m_cWnd.Get (), std::max (segmentSize, ssThresh / 2 / segmentSize * segmentSize),
+                         "cWnd not restarted from half of ssThresh");
+  NS_TEST_ASSERT_MSG_GT (tcb->m_cWnd.Get (), segmentSize,
+                         "cWnd restarted from one segment after a random loss");
+}
+
+void
+TcpCerlRandomRtoTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, true, "The lost retransmission did not cause an RTO");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for TcpCerl driven by TcpSocketBase
+ */
+class TcpCerlSocketTestSuite : public TestSuite
+{
+public:
+  TcpCerlSocketTestSuite () : TestSuite ("tcp-cerl-socket", UNIT)
+  {
+    AddTestCase (new TcpCerlRtoTest ("RTO in the episode of a congestive loss"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlRandomLossTest ("Window kept across a random loss recovery"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlRandomRtoTest ("Window restarted from half of ssThresh after a random RTO"),
+                 TestCase::QUICK);
+  }
+};
+
+static TcpCerlSocketTestSuite g_tcpCerlSocketTest; //!< Static variable for test initialization
@@ -0,0 +1,649 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <vector>
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/tcp-congestion-ops.h"
+#include "ns3/tcp-socket-base.h"
+#include "ns3/tcp-cerl.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TcpCerlTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the window increase of TcpCerl against TcpNewReno
+ *
+ * Cerl does not modify the NewReno increase: whatever the number of RTT
+ * samples collected and whether the connection is in slow start or in
+ * congestion avoidance, the cWnd after IncreaseWindow must be the same
+ * as the one computed by TcpNewReno on the same state.
+ */
+class TcpCerlIncreaseWindowTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param cWnd congestion window
+   * \param segmentSize segment size
+   * \param ssThresh slow start threshold
+   * \param segmentsAcked segments acked
+   * \param rtt RTT of the samples
+   * \param samples number of RTT samples fed before the increase
+   * \param name test description
+   */
+  TcpCerlIncreaseWindowTest (uint32_t cWnd, uint32_t segmentSize,
+                             uint32_t ssThresh, uint32_t segmentsAcked,
+                             Time rtt, uint32_t samples,
+                             const std::string &name);
+
+private:
+  virtual void DoRun (void);
+
+  uint32_t m_cWnd;        //!< Congestion window
+  uint32_t m_segmentSize; //!< Segment size
+  uint32_t m_ssThresh;    //!< Slow start threshold
+  uint32_t m_segmentsAcked; //!< Number of segments ACKed
+  Time m_rtt;             //!< RTT
+  uint32_t m_samples;     //!< Number of RTT samples
+};
+
+TcpCerlIncreaseWindowTest::TcpCerlIncreaseWindowTest (uint32_t cWnd,
+                                                      uint32_t segmentSize,
+                                                      uint32_t ssThresh,
+                                                      uint32_t segmentsAcked,
+                                                      Time rtt,
+                                                      uint32_t samples,
+                                                      const std::string &name)
+  : TestCase (name),
+    m_cWnd (cWnd),
+    m_segmentSize (segmentSize),
+    m_ssThresh (ssThresh),
+    m_segmentsAcked (segmentsAcked),
+    m_rtt (rtt),
+    m_samples (samples)
+{
+}
+
+void
+TcpCerlIncreaseWindowTest::DoRun ()
+{
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_cWnd = m_cWnd;
+  state->m_ssThresh = m_ssThresh;
+  state->m_segmentSize = m_segmentSize;
+
+  Ptr<TcpSocketState> renoState = CopyObject<TcpSocketState> (state);
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+  for (uint32_t i = 0; i < m_samples; ++i)
+    {
+      cong->PktsAcked (state, 1, m_rtt);
+    }
+  cong->IncreaseWindow (state, m_segmentsAcked);
+
+  Ptr<TcpNewReno> reno = CreateObject<TcpNewReno> ();
+  reno->IncreaseWindow (renoState, m_segmentsAcked);
+
+  NS_TEST_ASSERT_MSG_EQ (state->m_cWnd.Get (), renoState->m_cWnd.Get (),
+                         "cWnd differs from the NewReno one");
+  NS_TEST_ASSERT_MSG_EQ (state->m_ssThresh.Get (), m_ssThresh,
+                         "ssThresh modified by IncreaseWindow");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the backlog estimation and the dynamic queue length threshold
+ *
+ * With BaseRTT measured first and a larger RTT measured afterwards, the
+ * backlog is cwnd - cwnd * BaseRTT / RTT segments, and the threshold
+ * (exported through the "dqlt" attribute) is 55% of the largest backlog
+ * estimated so far.
+ */
+class TcpCerlQueueLengthTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param cWnd congestion window, in segments
+   * \param baseRtt propagation delay
+   * \param rtt RTT including the queueing delay
+   * \param expectedDqlt expected dynamic queue length threshold
+   * \param name test description
+   */
+  TcpCerlQueueLengthTest (uint32_t cWnd, Time baseRtt, Time rtt,
+                          uint32_t expectedDqlt, const std::string &name);
+
+private:
+  virtual void DoRun (void);
+
+  uint32_t m_cWnd;         //!< Congestion window, in segments
+  Time m_baseRtt;          //!< Propagation delay
+  Time m_rtt;              //!< RTT with queueing delay
+  uint32_t m_expectedDqlt; //!< Expected threshold
+};
+
+TcpCerlQueueLengthTest::TcpCerlQueueLengthTest (uint32_t cWnd, Time baseRtt,
+                                                Time rtt, uint32_t expectedDqlt,
+                                                const std::string &name)
+  : TestCase (name),
+    m_cWnd (cWnd),
+    m_baseRtt (baseRtt),
+    m_rtt (rtt),
+    m_expectedDqlt (expectedDqlt)
+{
+}
+
+void
+TcpCerlQueueLengthTest::DoRun ()
+{
+  const uint32_t segmentSize = 1000;
+
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_segmentSize = segmentSize;
+  state->m_cWnd = m_cWnd * segmentSize;
+  state->m_ssThresh = UINT32_MAX;
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+  UintegerValue dqlt;
+
+  // BaseRTT only: the queue is empty
+  cong->PktsAcked (state, 1, m_baseRtt);
+  state->m_cWnd = m_cWnd * segmentSize;
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), 0, "Threshold not zero with an empty queue");
+
+  // Queueing delay: the threshold follows the backlog
+  cong->PktsAcked (state, 1, m_rtt);
+  state->m_cWnd = m_cWnd * segmentSize;
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), m_expectedDqlt, "Wrong threshold");
+
+  // Empty queue again: the threshold is kept
+  cong->PktsAcked (state, 1, m_baseRtt);
+  state->m_cWnd = m_cWnd * segmentSize;
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), m_expectedDqlt, "Threshold decreased");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the configurable and decaying threshold of TcpCerl
+ *
+ * The threshold is DqltFactor times the largest backlog estimated over
+ * the last DqltWindow RTTs: a single spike of the backlog must not raise
+ * the threshold for longer than the window.
+ */
+class TcpCerlDqltDecayTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param factor value of the DqltFactor attribute
+   * \param window value of the DqltWindow attribute
+   * \param expectedDqlt expected threshold after the spike
+   * \param name test description
+   */
+  TcpCerlDqltDecayTest (double factor, uint32_t window, uint32_t expectedDqlt,
+                        const std::string &name);
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Feed one RTT epoch with a single RTT sample
+   * \param cong the congestion control
+   * \param state the congestion state
+   * \param rtt the RTT sample
+   * \return the threshold at the end of the epoch
+   */
+  uint32_t Epoch (Ptr<TcpCerl> cong, Ptr<TcpSocketState> state, Time rtt);
+
+  double m_factor;         //!< DqltFactor
+  uint32_t m_window;       //!< DqltWindow
+  uint32_t m_expectedDqlt; //!< Expected threshold after the spike
+};
+
+TcpCerlDqltDecayTest::TcpCerlDqltDecayTest (double factor, uint32_t window,
+                                            uint32_t expectedDqlt,
+                                            const std::string &name)
+  : TestCase (name),
+    m_factor (factor),
+    m_window (window),
+    m_expectedDqlt (expectedDqlt)
+{
+}
+
+uint32_t
+TcpCerlDqltDecayTest::Epoch (Ptr<TcpCerl> cong, Ptr<TcpSocketState> state, Time rtt)
+{
+  // SND.UNA and SND.NXT are left at zero: every ACK ends an epoch
+  cong->PktsAcked (state, 1, rtt);
+  cong->IncreaseWindow (state, 0);
+
+  UintegerValue dqlt;
+  cong->GetAttribute ("dqlt", dqlt);
+  return dqlt.Get ();
+}
+
+void
+TcpCerlDqltDecayTest::DoRun ()
+{
+  const uint32_t segmentSize = 1000;
+
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_segmentSize = segmentSize;
+  state->m_cWnd = 40 * segmentSize;
+  state->m_ssThresh = UINT32_MAX;
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+  cong->SetAttribute ("DqltFactor", DoubleValue (m_factor));
+  cong->SetAttribute ("DqltWindow", UintegerValue (m_window));
+
+  NS_TEST_ASSERT_MSG_EQ (Epoch (cong, state, MilliSeconds (100)), 0,
+                         "Threshold not zero with an empty queue");
+
+  // Spike of 30 segments (RTT x4)
+  NS_TEST_ASSERT_MSG_EQ (Epoch (cong, state, MilliSeconds (400)), m_expectedDqlt,
+                         "Wrong threshold after the spike");
+  NS_TEST_ASSERT_MSG_EQ (Epoch (cong, state, MilliSeconds (100)), m_expectedDqlt,
+                         "Threshold decayed immediately after the spike");
+
+  // Once the spike is out of the window, the threshold follows the
+  // (empty) queue again
+  uint32_t dqlt = m_expectedDqlt;
+  for (uint32_t i = 0; i < m_window + 1; ++i)
+    {
+      dqlt = Epoch (cong, state, MilliSeconds (100));
+    }
+  NS_TEST_ASSERT_MSG_EQ (dqlt, 0, "Threshold not decayed after the window");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the per-RTT sampling epochs of TcpCerl
+ *
+ * The backlog is estimated only once per RTT, when the segment that was
+ * the next to be sent at the start of the epoch is acknowledged, and from
+ * the smallest RTT sample of the whole epoch.
+ */
+class TcpCerlEpochTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param name test description
+   */
+  TcpCerlEpochTest (const std::string &name);
+
+private:
+  virtual void DoRun (void);
+};
+
+TcpCerlEpochTest::TcpCerlEpochTest (const std::string &name)
+  : TestCase (name)
+{
+}
+
+void
+TcpCerlEpochTest::DoRun ()
+{
+  const uint32_t segmentSize = 1000;
+
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_segmentSize = segmentSize;
+  state->m_cWnd = 10 * segmentSize;
+  state->m_ssThresh = UINT32_MAX;
+  state->m_lastAckedSeq = SequenceNumber32 (1);
+  state->m_nextTxSequence = SequenceNumber32 (10001);
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+  cong->CongestionStateSet (state, TcpSocketState::CA_OPEN);
+  UintegerValue dqlt;
+
+  // First epoch, ending with the ACK of segment 10001: no backlog
+  state->m_lastAckedSeq = SequenceNumber32 (10001);
+  state->m_nextTxSequence = SequenceNumber32 (20001);
+  cong->PktsAcked (state, 1, MilliSeconds (100));
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), 0, "Threshold not zero with an empty queue");
+
+  // Within the second epoch: samples are collected, the estimate is not updated
+  state->m_lastAckedSeq = SequenceNumber32 (12001);
+  cong->PktsAcked (state, 1, MilliSeconds (400));
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), 0, "Backlog estimated before the end of the epoch");
+
+  state->m_lastAckedSeq = SequenceNumber32 (16001);
+  cong->PktsAcked (state, 1, MilliSeconds (200));
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), 0, "Backlog estimated before the end of the epoch");
+
+  // End of the second epoch: the backlog (5 segments) comes from the
+  // smallest sample of the epoch, 200 ms
+  state->m_lastAckedSeq = SequenceNumber32 (20001);
+  cong->PktsAcked (state, 1, MilliSeconds (300));
+  cong->IncreaseWindow (state, 0);
+  cong->GetAttribute ("dqlt", dqlt);
+  NS_TEST_ASSERT_MSG_EQ (dqlt.Get (), 2, "Backlog not estimated from the epoch minimum");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the loss classification of TcpCerl
+ *
+ * A loss detected while the estimated backlog is above the threshold is
+ * congestive, and ssThresh is halved as in NewReno, once per window of
+ * data: a second congestive loss below the recovery point returns the
+ * same ssThresh. A loss detected with
+ * a backlog below the threshold is random: ssThresh is set to the bytes in
+ * flight, so that cWnd is not reduced, and the loss response tells the
+ * socket to keep the window. NewReno never keeps it.
+ */
+class TcpCerlLossTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param congestive true if the loss is detected with a full queue
+   * \param name test description
+   */
+  TcpCerlLossTest (bool congestive, const std::string &name);
+
+private:
+  virtual void DoRun (void);
+
+  /**
+   * \brief Record a loss classification decision
+   * \param now the time of the decision
+   * \param lossClass the outcome of the classification
+   * \param sndUna the first unacknowledged sequence number
+   * \param cWnd the congestion window
+   * \param bytesInFlight the bytes in flight
+   * \param qlength the estimated backlog
+   * \param dqlt the threshold for congestion detection
+   */
+  void LossClassified (Time now, TcpCerl::LossClass_t lossClass, SequenceNumber32 sndUna,
+                       uint32_t cWnd, uint32_t bytesInFlight, uint32_t qlength, uint32_t dqlt);
+
+  bool m_congestive; //!< Loss detected with a backlog above the threshold
+  std::vector<TcpCerl::LossClass_t> m_decisions; //!< Traced decisions
+  uint32_t m_tracedBytesInFlight; //!< Bytes in flight of the last traced decision
+};
+
+TcpCerlLossTest::TcpCerlLossTest (bool congestive, const std::string &name)
+  : TestCase (name),
+    m_congestive (congestive),
+    m_tracedBytesInFlight (0)
+{
+}
+
+void
+TcpCerlLossTest::LossClassified (Time now, TcpCerl::LossClass_t lossClass, SequenceNumber32 sndUna,
+                                 uint32_t cWnd, uint32_t bytesInFlight, uint32_t qlength, uint32_t dqlt)
+{
+  NS_LOG_FUNCTION (this << now << TcpCerl::LossClassName[lossClass] << sndUna << cWnd
+                        << bytesInFlight << qlength << dqlt);
+  m_decisions.push_back (lossClass);
+  m_tracedBytesInFlight = bytesInFlight;
+}
+
+void
+TcpCerlLossTest::DoRun ()
+{
+  const uint32_t segmentSize = 1000;
+  const uint32_t cWnd = 20 * segmentSize;
+  const uint32_t bytesInFlight = 16 * segmentSize;
+
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_segmentSize = segmentSize;
+  state->m_cWnd = cWnd;
+  state->m_ssThresh = UINT32_MAX;
+  state->m_highTxMark = SequenceNumber32 (20001);
+  state->m_lastAckedSeq = SequenceNumber32 (10001);
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+  cong->TraceConnectWithoutContext ("LossClassification",
+                                    MakeCallback (&TcpCerlLossTest::LossClassified, this));
+
+  // Build a backlog of 10 segments (RTT doubled), so that the threshold
+  // is 5 segments
+  cong->PktsAcked (state, 1, MilliSeconds (100));
+  cong->IncreaseWindow (state, 0);
+  state->m_cWnd = cWnd;
+  cong->PktsAcked (state, 1, MilliSeconds (200));
+  cong->IncreaseWindow (state, 0);
+  state->m_cWnd = cWnd;
+
+  if (!m_congestive)
+    {
+      // Queue drained before the loss
+      cong->PktsAcked (state, 1, MilliSeconds (100));
+      cong->IncreaseWindow (state, 0);
+      state->m_cWnd = cWnd;
+    }
+
+  uint32_t ssThresh = cong->GetSsThresh (state, bytesInFlight);
+
+  if (m_congestive)
+    {
+      NS_TEST_ASSERT_MSG_EQ (ssThresh, bytesInFlight / 2,
+                             "Congestive loss does not halve the window");
+
+      // A second loss in the same window of data (an RTO, or a replay of
+      // the loss) is below the recovery point: only one reduction
+      ssThresh = cong->GetSsThresh (state, bytesInFlight / 2);
+      NS_TEST_ASSERT_MSG_EQ (ssThresh, bytesInFlight / 2,
+                             "Second loss in the same window reduces the window again");
+    }
+  else
+    {
+      NS_TEST_ASSERT_MSG_EQ (ssThresh, bytesInFlight,
+                             "Random loss reduces the window");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_decisions.size (), m_congestive ? 2u : 1u,
+                         "One trace per classification expected");
+  for (std::vector<TcpCerl::LossClass_t>::const_iterator it = m_decisions.begin ();
+       it != m_decisions.end (); ++it)
+    {
+      NS_TEST_ASSERT_MSG_EQ (*it, m_congestive ? TcpCerl::CONGESTIVE_LOSS
+                                               : TcpCerl::RANDOM_LOSS,
+                             "Wrong traced classification");
+    }
+  NS_TEST_ASSERT_MSG_EQ (m_tracedBytesInFlight, bytesInFlight,
+                         "Wrong traced bytes in flight");
+
+  // Once SND.UNA reaches the recovery point, a loss starts a new episode
+  state->m_lastAckedSeq = state->m_highTxMark;
+  state->m_highTxMark = SequenceNumber32 (40001);
+
+  // The lower bound is two segments in both cases
+  NS_TEST_ASSERT_MSG_EQ (cong->GetSsThresh (state, segmentSize), 2 * segmentSize,
+                         "ssThresh below two segments");
+
+  // The socket reads the same decision from the response
+  state->m_lastAckedSeq = state->m_highTxMark;
+  state->m_highTxMark = SequenceNumber32 (60001);
+  TcpCongestionOps::LossResponse response = cong->GetLossResponse (state, bytesInFlight);
+  NS_TEST_ASSERT_MSG_EQ (response.ssThresh, m_congestive ? bytesInFlight / 2 : bytesInFlight,
+                         "Wrong ssThresh in the loss response");
+  NS_TEST_ASSERT_MSG_EQ (response.keepCwnd, !m_congestive,
+                         "Only a random loss keeps the window");
+
+  // The default response of the other congestion controls reduces the window
+  Ptr<TcpNewReno> newReno = CreateObject<TcpNewReno> ();
+  response = newReno->GetLossResponse (state, bytesInFlight);
+  NS_TEST_ASSERT_MSG_EQ (response.ssThresh, bytesInFlight / 2,
+                         "Default loss response is not GetSsThresh");
+  NS_TEST_ASSERT_MSG_EQ (response.keepCwnd, false,
+                         "Default loss response keeps the window");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the pacing rate of TcpCerl
+ *
+ * With pacing enabled, the pacing rate is the window minus the estimated
+ * backlog per BaseRTT, scaled by the pacing ratio of the current phase.
+ * It is left to the socket while the connection is not in CA_OPEN, and
+ * not set at all when pacing is disabled.
+ */
+class TcpCerlPacingTest : public TestCase
+{
+public:
+  /**
+   * \brief Constructor
+   * \param pacing true if pacing is enabled
+   * \param name test description
+   */
+  TcpCerlPacingTest (bool pacing, const std::string &name);
+
+private:
+  virtual void DoRun (void);
+
+  bool m_pacing; //!< Pacing enabled
+};
+
+TcpCerlPacingTest::TcpCerlPacingTest (bool pacing, const std::string &name)
+  : TestCase (name),
+    m_pacing (pacing)
+{
+}
+
+void
+TcpCerlPacingTest::DoRun ()
+{
+  const uint32_t segmentSize = 1000;
+  const uint32_t cWnd = 20 * segmentSize;
+
+  Ptr<TcpSocketState> state = CreateObject<TcpSocketState> ();
+  state->m_segmentSize = segmentSize;
+  state->m_cWnd = cWnd;
+  state->m_ssThresh = UINT32_MAX;
+  state->m_pacing = m_pacing;
+  state->m_pacingSsRatio = 200;
+  state->m_pacingCaRatio = 120;
+
+  Ptr<TcpCerl> cong = CreateObject<TcpCerl> ();
+
+  // Backlog of 10 segments (RTT doubled): the bottleneck delivers 10
+  // segments per BaseRTT
+  cong->PktsAcked (state, 1, MilliSeconds (100));
+  cong->IncreaseWindow (state, 0);
+  cong->PktsAcked (state, 1, MilliSeconds (200));
+  cong->IncreaseWindow (state, 0);
+
+  if (!m_pacing)
+    {
+      NS_TEST_ASSERT_MSG_EQ (state->m_ccPacingRate.GetBitRate (), 0,
+                             "Pacing rate set with pacing disabled");
+      return;
+    }
+
+  // Slow start: 10 segments per 100 ms, doubled
+  NS_TEST_ASSERT_MSG_EQ_TOL (static_cast<double> (state->m_ccPacingRate.GetBitRate ()),
+                             1600000.0, 1.0, "Wrong slow start pacing rate");
+
+  // Congestion avoidance: 10 segments per 100 ms, 120%
+  state->m_ssThresh = cWnd;
+  cong->IncreaseWindow (state, 0);
+  NS_TEST_ASSERT_MSG_EQ_TOL (static_cast<double> (state->m_ccPacingRate.GetBitRate ()),
+                             960000.0, 1.0, "Wrong congestion avoidance pacing rate");
+
+  // Recovery: the rate is left to the socket
+  cong->CongestionStateSet (state, TcpSocketState::CA_RECOVERY);
+  NS_TEST_ASSERT_MSG_EQ (state->m_ccPacingRate.GetBitRate (), 0,
+                         "Pacing rate kept in recovery");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the behavior of TcpCerl
+ */
+class TcpCerlTestSuite : public TestSuite
+{
+public:
+  TcpCerlTestSuite () : TestSuite ("tcp-cerl-test", UNIT)
+  {
+    AddTestCase (new TcpCerlIncreaseWindowTest (4 * 1000, 1000, 8 * 1000, 1,
+                                                MilliSeconds (100), 1,
+                                                "Slow start, one segment acked"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlIncreaseWindowTest (4 * 1000, 1000, 8 * 1000, 2,
+                                                MilliSeconds (100), 3,
+                                                "Slow start, two segments acked"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlIncreaseWindowTest (10 * 1000, 1000, 5 * 1000, 1,
+                                                MilliSeconds (100), 5,
+                                                "Congestion avoidance"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlIncreaseWindowTest (10 * 500, 500, 5 * 500, 1,
+                                                MilliSeconds (10), 5,
+                                                "Congestion avoidance, small segments"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlQueueLengthTest (10, MilliSeconds (100), MilliSeconds (200), 2,
+                                             "Backlog of 5 segments"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlQueueLengthTest (40, MilliSeconds (100), MilliSeconds (400), 16,
+                                             "Backlog of 30 segments"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlQueueLengthTest (7, MilliSeconds (100), MilliSeconds (300), 2,
+                                             "Backlog with a truncated target window"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlQueueLengthTest (1000, MicroSeconds (100001), MicroSeconds (100003), 0,
+                                             "Small queueing delay"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlQueueLengthTest (10, MilliSeconds (100), MilliSeconds (100), 0,
+                                             "No backlog"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlDqltDecayTest (0.55, 4, 16, "Default factor, window of 4 RTTs"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlDqltDecayTest (0.5, 10, 15, "Factor 0.5, window of 10 RTTs"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpCerlEpochTest ("Backlog estimated once per RTT"), TestCase::QUICK);
+    AddTestCase (new TcpCerlLossTest (true, "Congestive loss"), TestCase::QUICK);
+    AddTestCase (new TcpCerlLossTest (false, "Random loss"), TestCase::QUICK);
+    AddTestCase (new TcpCerlPacingTest (true, "Pacing from the backlog"), TestCase::QUICK);
+    AddTestCase (new TcpCerlPacingTest (false, "Pacing disabled"), TestCase::QUICK);
+  }
+};
+
+static TcpCerlTestSuite g_tcpCerlTest; //!< Static variable for test initialization
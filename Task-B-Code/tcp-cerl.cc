@@ -28,12 +28,21 @@
 #include "tcp-socket-state.h"
 #include "tcp-socket-base.h"
 #include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/double.h"
+#include "ns3/uinteger.h"
 
 namespace ns3 {
 
 NS_LOG_COMPONENT_DEFINE ("TcpCerl");
 NS_OBJECT_ENSURE_REGISTERED (TcpCerl);
 
+const char* const
+TcpCerl::LossClassName[TcpCerl::RANDOM_LOSS + 1] =
+{
+  "CONGESTIVE_LOSS", "RANDOM_LOSS"
+};
+
 TypeId
 TcpCerl::GetTypeId (void)
 {
@@ -45,6 +54,37 @@ TcpCerl::GetTypeId (void)
                    UintegerValue (0),
                    MakeUintegerAccessor (&TcpCerl::m_dqlt),
                    MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("DqltFactor",
+                   "Fraction of the maximum backlog used as threshold for congestion detection",
+                   DoubleValue (0.55),
+                   MakeDoubleAccessor (&TcpCerl::m_dqltFactor),
+                   MakeDoubleChecker<double> (0.0, 1.0))
+    .AddAttribute ("DqltWindow",
+                   "Number of RTTs over which the maximum backlog is tracked",
+                   UintegerValue (10),
+                   MakeUintegerAccessor (&TcpCerl::SetDqltWindow,
+                                         &TcpCerl::GetDqltWindow),
+                   MakeUintegerChecker<uint32_t> (1))
+    .AddTraceSource ("QueueLength",
+                     "Estimated backlog at the bottleneck queue, in segments",
+                     MakeTraceSourceAccessor (&TcpCerl::m_qlength),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("Dqlt",
+                     "Threshold for congestion detection, in segments",
+                     MakeTraceSourceAccessor (&TcpCerl::m_dqlt),
+                     "ns3::TracedValueCallback::Uint32")
+    .AddTraceSource ("BaseRtt",
+                     "Minimum of all RTT measurements seen during the connection",
+                     MakeTraceSourceAccessor (&TcpCerl::m_baseRtt),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("MinRtt",
+                     "Minimum of the RTTs measured within the current RTT epoch",
+                     MakeTraceSourceAccessor (&TcpCerl::m_minRtt),
+                     "ns3::TracedValueCallback::Time")
+    .AddTraceSource ("LossClassification",
+                     "Classification of each loss as congestive or random",
+                     MakeTraceSourceAccessor (&TcpCerl::m_lossClassTrace),
+                     "ns3::TcpCerl::LossClassificationTracedCallback")
   ;
   return tid;
 }
@@ -54,11 +94,16 @@ TcpCerl::TcpCerl (void)
     m_baseRtt (Time::Max ()),
     m_minRtt (Time::Max ()),
     m_cntRtt (0),
-    m_doingCerlNow (true),
     m_qlength (0),
-    m_inc (true),
-    m_ackCnt (0),
-    m_dqlt (0)
+    m_qlengthMax (10, 0, 0),
+    m_epoch (0),
+    m_dqlt (0),
+    m_dqltFactor (0.55),
+    m_dqltWindow (10),
+    m_begSndNxt (0),
+    m_recover (0),
+    m_recoverActive (false),
+    m_recoverSsThresh (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -68,14 +113,16 @@ TcpCerl::TcpCerl (const TcpCerl& sock)
     m_baseRtt (sock.m_baseRtt),
     m_minRtt (sock.m_minRtt),
     m_cntRtt (sock.m_cntRtt),
-    m_doingCerlNow (true),
     m_qlength (0),
-    m_qlengthMax(0), //---added---
-    m_inc (true),
-    m_ackCnt (sock.m_ackCnt),
+    m_qlengthMax (sock.m_dqltWindow, 0, 0),
+    m_epoch (0),
     m_dqlt (0) , //---added---
-    m_maxSentSeqno (0),
-    m_highestAckSent (0)
+    m_dqltFactor (sock.m_dqltFactor),
+    m_dqltWindow (sock.m_dqltWindow),
+    m_begSndNxt (0),
+    m_recover (0),
+    m_recoverActive (false),
+    m_recoverSsThresh (0)
 {
   NS_LOG_FUNCTION (this);
 }
@@ -91,6 +138,20 @@ TcpCerl::Fork (void)
   return CopyObject<TcpCerl> (this);
 }
 
+void
+TcpCerl::SetDqltWindow (uint32_t window)
+{
+  NS_LOG_FUNCTION (this << window);
+  m_dqltWindow = window;
+  m_qlengthMax.SetWindowLength (window);
+}
+
+uint32_t
+TcpCerl::GetDqltWindow (void) const
+{
+  return m_dqltWindow;
+}
+
 void
 TcpCerl::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
                     const Time& rtt)
@@ -102,12 +163,17 @@ TcpCerl::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
       return;
     }
 
-  m_minRtt = std::min (m_minRtt, rtt);
-  NS_LOG_DEBUG ("Updated m_minRtt= " << m_minRtt);
-
+  if (rtt < m_minRtt)
+    {
+      m_minRtt = rtt;
+      NS_LOG_DEBUG ("Updated m_minRtt= " << m_minRtt);
+    }
 
-  m_baseRtt = std::min (m_baseRtt, rtt);
-  NS_LOG_DEBUG ("Updated m_baseRtt= " << m_baseRtt);
+  if (rtt < m_baseRtt)
+    {
+      m_baseRtt = rtt;
+      NS_LOG_DEBUG ("Updated m_baseRtt= " << m_baseRtt);
+    }
 
   // Update RTT counter
   m_cntRtt++;
@@ -115,22 +181,15 @@ TcpCerl::PktsAcked (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked,
 }
 
 void
-TcpCerl::EnableCerl ()
+TcpCerl::EnableCerl (Ptr<TcpSocketState> tcb)
 {
-  NS_LOG_FUNCTION (this);
+  NS_LOG_FUNCTION (this << tcb);
 
-  m_doingCerlNow = true;
+  m_begSndNxt = tcb->m_nextTxSequence;
+  m_cntRtt = 0;
   m_minRtt = Time::Max ();
 }
 
-void
-TcpCerl::DisableCerl ()
-{
-  NS_LOG_FUNCTION (this);
-
-  m_doingCerlNow = false;
-}
-
 void
 TcpCerl::CongestionStateSet (Ptr<TcpSocketState> tcb,
                              const TcpSocketState::TcpCongState_t newState)
@@ -138,14 +197,39 @@ TcpCerl::CongestionStateSet (Ptr<TcpSocketState> tcb,
   NS_LOG_FUNCTION (this << tcb << newState);
   if (newState == TcpSocketState::CA_OPEN)
     {
-      EnableCerl ();
-      NS_LOG_LOGIC ("Cerl is now on.");
+      EnableCerl (tcb);
+      NS_LOG_LOGIC ("New Cerl epoch started.");
     }
   else
     {
-      DisableCerl ();
-      NS_LOG_LOGIC ("Cerl is turned off.");
+      NS_LOG_LOGIC ("Not in CA_OPEN, the pacing rate is left to the socket.");
+      // The window is driven by the recovery: let the socket pace it
+      tcb->m_ccPacingRate = DataRate (0);
+    }
+}
+
+uint32_t
+TcpCerl::EstimateBacklog (uint32_t segCwnd, int64_t baseRtt, int64_t rtt)
+{
+  if (segCwnd == 0 || rtt <= baseRtt || baseRtt < 0)
+    {
+      return 0;
     }
+
+  // targetCwnd = segCwnd * baseRtt / rtt, computed on the integer time
+  // steps. Both RTTs are scaled down (keeping their ratio) in the unlikely
+  // case that the product does not fit in 64 bits.
+  uint64_t base = static_cast<uint64_t> (baseRtt);
+  uint64_t cur = static_cast<uint64_t> (rtt);
+  while (base > UINT64_MAX / segCwnd)
+    {
+      base >>= 1;
+      cur >>= 1;
+    }
+  uint64_t targetCwnd = segCwnd * base / cur;
+
+  // baseRtt < rtt, hence targetCwnd < segCwnd
+  return segCwnd - static_cast<uint32_t> (targetCwnd);
 }
 
 void
@@ -153,61 +237,71 @@ TcpCerl::IncreaseWindow (Ptr<TcpSocketState> tcb, uint32_t segmentsAcked)
 {
   NS_LOG_FUNCTION (this << tcb << segmentsAcked);
 
-  // Always calculate m_qlength, even if we are not doing Cerl now
-  //----calculating bottleneck queue length----
-  uint32_t targetCwnd;
-  uint32_t segCwnd = tcb->GetCwndInSegments ();
-  double tmp = m_baseRtt.GetSeconds () / m_minRtt.GetSeconds ();
-  targetCwnd = static_cast<uint32_t> (segCwnd * tmp);
-
-  NS_ASSERT (segCwnd >= targetCwnd); // implies baseRtt <= minRtt
-  m_qlength = segCwnd - targetCwnd;
-  NS_LOG_DEBUG ("Calculated m_qlength(L) = " << m_qlength);
-  
-  //----calculating dynamic queue length threshold----
-  if(m_qlength>m_qlengthMax){
-     m_qlengthMax=m_qlength;
-  }
-  m_dqlt=0.55*m_qlengthMax;    
-  
-  NS_LOG_DEBUG ("Calculated m_bqlt(N) = " << m_dqlt);
- 
-  //--------------------------------------------------
-
-  if (!m_doingCerlNow)
-    {
-      // If Cerl is not on, we follow NewReno algorithm
-      NS_LOG_LOGIC ("Cerl is not turned on, we follow NewReno algorithm.");
-      TcpNewReno::IncreaseWindow (tcb, segmentsAcked);
-      return;
-    }
+  // Always calculate m_qlength, also in slow start
+  if (tcb->m_lastAckedSeq >= m_begSndNxt)
+    { // A Cerl epoch has finished, we estimate the backlog once every RTT,
+      // from the smallest RTT measured during the epoch.
+      m_begSndNxt = tcb->m_nextTxSequence;
+      m_epoch++;
 
-  // We do the Cerl calculations only if we got enough RTT samples
-  if (m_cntRtt <= 2)//----------confusion !!!
-    {    // We do not have enough RTT samples, so we should behave like NewReno
-      NS_LOG_LOGIC ("We do not have enough RTT samples to perform Cerl "
-                    "calculations, we behave like NewReno.");
-      TcpNewReno::IncreaseWindow (tcb, segmentsAcked);
-    }
-  else
-    {
-      NS_LOG_LOGIC ("We have enough RTT samples to perform Cerl calculations.");
+      if (m_cntRtt > 0)
+        {
+          //----calculating bottleneck queue length----
+          m_qlength = EstimateBacklog (tcb->GetCwndInSegments (),
+                                       m_baseRtt.Get ().GetTimeStep (),
+                                       m_minRtt.Get ().GetTimeStep ());
+          NS_LOG_DEBUG ("Calculated m_qlength(L) = " << m_qlength <<
+                        " from " << m_cntRtt << " RTT samples");
 
-      if (tcb->m_cWnd < tcb->m_ssThresh)
-        { // Slow start mode. Cerl employs same slow start algorithm as NewReno's.
-          NS_LOG_LOGIC ("We are in slow start, behave like NewReno.");
-          TcpNewReno::SlowStart (tcb, segmentsAcked);
+          //----calculating dynamic queue length threshold----
+          // The maximum backlog is taken over the last m_dqltWindow epochs,
+          // so that a transient spike does not raise the threshold for the
+          // rest of the connection.
+          m_qlengthMax.Update (m_qlength, m_epoch);
+          m_dqlt = static_cast<uint32_t> (m_dqltFactor * m_qlengthMax.GetBest ());
+          NS_LOG_DEBUG ("Calculated m_dqlt(N) = " << m_dqlt);
         }
       else
-        { // Congestion avoidance mode
-          NS_LOG_LOGIC ("We are in congestion avoidance, behave like NewReno.");
-          TcpNewReno::CongestionAvoidance (tcb, segmentsAcked);
+        {
+          NS_LOG_LOGIC ("No RTT sample during the last RTT, m_qlength not updated.");
         }
+
+      // Reset cntRtt & minRtt every RTT
+      m_cntRtt = 0;
+      m_minRtt = Time::Max ();
     }
 
-  // Reset cntRtt & minRtt every RTT
-  m_cntRtt = 0;
-  m_minRtt = Time::Max ();
+  // Cerl employs the same slow start and congestion avoidance algorithms
+  // as NewReno's, whether Cerl is on or not.
+  TcpNewReno::IncreaseWindow (tcb, segmentsAcked);
+
+  if (tcb->m_pacing)
+    {
+      UpdatePacingRate (tcb);
+    }
+}
+
+void
+TcpCerl::UpdatePacingRate (Ptr<TcpSocketState> tcb) const
+{
+  NS_LOG_FUNCTION (this << tcb);
+
+  if (m_baseRtt.Get () == Time::Max ())
+    {
+      return;
+    }
+
+  uint32_t backlog = m_qlength * tcb->m_segmentSize;
+  uint32_t cWnd = tcb->m_cWnd;
+  uint32_t window = cWnd > backlog ? cWnd - backlog : 0;
+  window = std::max (window, 2 * tcb->m_segmentSize);
+
+  uint16_t ratio = cWnd < tcb->m_ssThresh / 2 ? tcb->m_pacingSsRatio
+                                                : tcb->m_pacingCaRatio;
+  double bps = window * 8.0 * ratio / 100 / m_baseRtt.Get ().GetSeconds ();
+  tcb->m_ccPacingRate = DataRate (static_cast<uint64_t> (bps));
+  NS_LOG_DEBUG ("Pacing rate " << tcb->m_ccPacingRate << " from " << window <<
+                " bytes per BaseRTT, backlog " << m_qlength);
 }
 
 std::string
@@ -221,29 +315,53 @@ TcpCerl::GetSsThresh (Ptr<const TcpSocketState> tcb,
                       uint32_t bytesInFlight)
 {
   NS_LOG_FUNCTION (this << tcb << bytesInFlight);
-  
-  if(m_highestAckSent < tcb->m_highTxAck){
-    m_highestAckSent=tcb->m_highTxAck;
-  }
-  
-  if (m_qlength >= m_dqlt && m_highestAckSent-1>m_maxSentSeqno)
+
+  return GetLossResponse (tcb, bytesInFlight).ssThresh;
+}
+
+TcpCerl::LossResponse
+TcpCerl::GetLossResponse (Ptr<const TcpSocketState> tcb,
+                          uint32_t bytesInFlight)
+{
+  NS_LOG_FUNCTION (this << tcb << bytesInFlight);
+
+  LossResponse response;
+  if (m_qlength >= m_dqlt)
     {
-      // congestion-based loss is most likely to have occurred,
-      // we reduce cwnd by 1/2 as in NewReno
-      NS_LOG_LOGIC ("Congestive loss is most likely to have occurred, "
-                    "cwnd is halved");
-      m_maxSentSeqno=tcb->m_highTxMark;               
-      return TcpNewReno::GetSsThresh (tcb, bytesInFlight);
+      // congestion-based loss is most likely to have occurred
+      m_lossClassTrace (Simulator::Now (), CONGESTIVE_LOSS, tcb->m_lastAckedSeq,
+                        tcb->m_cWnd, bytesInFlight, m_qlength, m_dqlt);
+
+      if (m_recoverActive && tcb->m_lastAckedSeq < m_recover)
+        {
+          // same window of data as the last reduction: reduce only once
+          NS_LOG_LOGIC ("Congestive loss below the recovery point " << m_recover <<
+                        ", cwnd already halved");
+          response.ssThresh = m_recoverSsThresh;
+        }
+      else
+        {
+          // we reduce cwnd by 1/2 as in NewReno
+          NS_LOG_LOGIC ("Congestive loss is most likely to have occurred, "
+                        "cwnd is halved");
+          response.ssThresh = TcpNewReno::GetSsThresh (tcb, bytesInFlight);
+          m_recover = tcb->m_highTxMark;
+          m_recoverActive = true;
+          m_recoverSsThresh = response.ssThresh;
+        }
+      response.keepCwnd = false;
     }
   else
     {
       // random loss due to bit errors is most likely to have occurred,
       NS_LOG_LOGIC ("Random loss is most likely to have occurred");
-      tcb->m_oldcWnd=bytesInFlight;
-      return std::max (static_cast<uint32_t> (bytesInFlight),
-                       2 * tcb->m_segmentSize); //---no change in cwnd and ssthresh
-                       
+      m_lossClassTrace (Simulator::Now (), RANDOM_LOSS, tcb->m_lastAckedSeq,
+                        tcb->m_cWnd, bytesInFlight, m_qlength, m_dqlt);
+      //---no change in cwnd and ssthresh
+      response.ssThresh = std::max (bytesInFlight, 2 * tcb->m_segmentSize);
+      response.keepCwnd = true;
     }
+  return response;
 }
 
 } // namespace ns3
@@ -28,6 +28,9 @@
 #define TCPCerl_H
 
 #include "tcp-congestion-ops.h"
+#include "windowed-filter.h"
+#include "ns3/traced-value.h"
+#include "ns3/traced-callback.h"
 
 namespace ns3 {
 
@@ -71,6 +74,35 @@ class TcpSocketState;
 class TcpCerl : public TcpNewReno
 {
 public:
+  /**
+   * \brief Outcome of the loss classification
+   */
+  typedef enum
+  {
+    CONGESTIVE_LOSS,  /**< Backlog above the threshold, cwnd is halved */
+    RANDOM_LOSS       /**< Backlog below the threshold, cwnd is kept */
+  } LossClass_t;
+
+  /**
+   * \brief Literal names of the loss classes, for use in log messages
+   */
+  static const char* const LossClassName[RANDOM_LOSS + 1];
+
+  /**
+   * \brief TracedCallback signature for the loss classification decisions
+   *
+   * \param [in] now the time of the decision
+   * \param [in] lossClass the outcome of the classification
+   * \param [in] sndUna the first unacknowledged (lost) sequence number
+   * \param [in] cWnd the congestion window when the loss was detected
+   * \param [in] bytesInFlight the bytes in flight when the loss was detected
+   * \param [in] qlength the estimated backlog, in segments
+   * \param [in] dqlt the threshold for congestion detection, in segments
+   */
+  typedef void (* LossClassificationTracedCallback)
+    (Time now, LossClass_t lossClass, SequenceNumber32 sndUna, uint32_t cWnd,
+     uint32_t bytesInFlight, uint32_t qlength, uint32_t dqlt);
+
   /**
    * \brief Get the type ID.
    * \return the object TypeId
@@ -110,9 +142,11 @@ public:
                           const Time& rtt);
 
   /**
-   * \brief Enable/disable Cerl depending on the congestion state
+   * \brief Restart the Cerl sampling depending on the congestion state
    *
-   * We only start a Cerl when we are in normal congestion state (CA_OPEN state).
+   * A new RTT epoch starts when the connection enters the normal
+   * congestion state (CA_OPEN state). In the other states the pacing
+   * rate is left to the socket.
    *
    * \param tcb internal congestion state
    * \param newState new congestion state to which the TCP is going to switch
@@ -123,6 +157,10 @@ public:
   /**
    * \brief Adjust cwnd following Cerl additive increase algorithm
    *
+   * The backlog at the bottleneck is estimated once per RTT, when the ACK of
+   * the first segment sent after the start of the current epoch arrives,
+   * using the smallest RTT sampled during the epoch.
+   *
    * \param tcb internal congestion state
    * \param segmentsAcked count of segments ACKed
    */
@@ -131,6 +169,16 @@ public:
   /**
    * \brief Get slow start threshold during Cerl multiplicative-decrease phase
    *
+   * A loss is congestive if the backlog reaches the threshold: ssThresh
+   * is then halved as in NewReno, and the recovery point is set to
+   * HighTxMark. A congestive loss detected while SND.UNA is below the
+   * recovery point belongs to the same episode, and returns the ssThresh
+   * of the first reduction: a fast retransmit, an RTO or an ECN echo in
+   * the same window of data reduce the window only once.
+   *
+   * A random loss returns the bytes in flight. The window decision is
+   * only available through GetLossResponse.
+   *
    * \param tcb internal congestion state
    * \param bytesInFlight bytes in flight
    *
@@ -139,8 +187,38 @@ public:
   virtual uint32_t GetSsThresh (Ptr<const TcpSocketState> tcb,
                                 uint32_t bytesInFlight);
 
+  /**
+   * \brief Classify a loss and get the response to it
+   *
+   * Same classification as GetSsThresh. A random loss keeps the window:
+   * the fast recovery does not deflate it, and an RTO does not restart
+   * from one segment. The classification of an RTO uses the last backlog
+   * estimate.
+   *
+   * \param tcb internal congestion state
+   * \param bytesInFlight bytes in flight
+   *
+   * \return the slow start threshold and whether the window is kept
+   */
+  virtual LossResponse GetLossResponse (Ptr<const TcpSocketState> tcb,
+                                        uint32_t bytesInFlight);
+
   virtual Ptr<TcpCongestionOps> Fork ();
 
+  /**
+   * \brief Set the number of RTTs over which the maximum backlog is tracked
+   *
+   * \param window the window length, in RTTs
+   */
+  void SetDqltWindow (uint32_t window);
+
+  /**
+   * \brief Get the number of RTTs over which the maximum backlog is tracked
+   *
+   * \return the window length, in RTTs
+   */
+  uint32_t GetDqltWindow (void) const;
+
 protected:
 private:
   /**
@@ -152,26 +230,62 @@ private:
    * 3. after fast recovery
    * 4. when an idle connection is restarted
    *
+   * \param tcb internal congestion state
+   */
+  void EnableCerl (Ptr<TcpSocketState> tcb);
+
+  /**
+   * \brief Estimate the backlog at the bottleneck queue
+   *
+   * Computes N = cwnd - cwnd * BaseRTT / RTT with integer arithmetic on the
+   * simulator time steps, so that the result does not depend on floating
+   * point rounding. The result is zero when RTT is not larger than BaseRTT.
+   *
+   * \param segCwnd congestion window, in segments
+   * \param baseRtt BaseRTT, in time steps
+   * \param rtt RTT, in time steps
+   * \return the backlog, in segments
    */
-  void EnableCerl ();
+  static uint32_t EstimateBacklog (uint32_t segCwnd, int64_t baseRtt, int64_t rtt);
 
   /**
-   * \brief Turn off Cerl
+   * \brief Set the pacing rate from the backlog estimate
+   *
+   * The bottleneck delivers cwnd - N segments per BaseRTT, which is the
+   * actual rate cwnd/RTT of Equation (1). The pacing rate is that rate,
+   * scaled by the slow start or congestion avoidance pacing ratio, so that
+   * the bursts are spread instead of filling the MAC queues, which would
+   * raise the RTT samples and the backlog estimate.
+   *
+   * \param tcb internal congestion state
    */
-  void DisableCerl ();
+  void UpdatePacingRate (Ptr<TcpSocketState> tcb) const;
 
 private:
-  Time m_baseRtt;                    //!< Minimum of all RTT measurements seen during connection
-  Time m_minRtt;                     //!< Minimum of RTTs measured within last RTT
+  /**
+   * \brief Windowed max filter of the backlog, with the time measured in RTT epochs
+   */
+  typedef WindowedFilter<uint32_t, MaxFilter<uint32_t>, uint32_t, uint32_t> MaxBacklogFilter_t;
+
+  TracedValue<Time> m_baseRtt;       //!< Minimum of all RTT measurements seen during connection
+  TracedValue<Time> m_minRtt;        //!< Minimum of RTTs measured within last RTT
   uint32_t m_cntRtt;                 //!< Number of RTT measurements during last RTT
-  bool m_doingCerlNow;               //!< If true, do Cerl for this RTT
-  uint32_t m_qlength;                   //!< Difference between expected and actual throughput
-  uint32_t m_qlengthMax;
-  bool m_inc;                        //!< If true, cwnd needs to be incremented
-  uint32_t m_ackCnt;                 //!< Number of received ACK
-  uint32_t m_dqlt;                   //!< Threshold for congestion detection
-  TracedValue<SequenceNumber32> m_maxSentSeqno ; //!< Highest seqno ever sent, regardless of ReTx
-  SequenceNumber32 m_highestAckSent;      //!< Highest ack sent
+  TracedValue<uint32_t> m_qlength;   //!< Estimated backlog at the bottleneck queue, in segments
+  MaxBacklogFilter_t m_qlengthMax;   //!< Largest backlog estimated in the last m_dqltWindow RTTs
+  uint32_t m_epoch;                  //!< Number of RTT epochs elapsed
+  TracedValue<uint32_t> m_dqlt;      //!< Threshold for congestion detection
+  double m_dqltFactor;               //!< Fraction of the maximum backlog used as threshold
+  uint32_t m_dqltWindow;             //!< Window of the maximum backlog filter, in RTTs
+  SequenceNumber32 m_begSndNxt;      //!< Right edge during last RTT
+  SequenceNumber32 m_recover;        //!< HighTxMark at the last reduction
+  bool m_recoverActive;              //!< A reduction happened, m_recover is valid
+  uint32_t m_recoverSsThresh;        //!< ssThresh set by the last reduction
+
+  /**
+   * \brief Trace of the loss classification decisions
+   */
+  TracedCallback<Time, LossClass_t, SequenceNumber32,
+                 uint32_t, uint32_t, uint32_t, uint32_t> m_lossClassTrace;
 };
 
 } // namespace ns3
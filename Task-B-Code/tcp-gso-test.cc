@@ -0,0 +1,184 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "tcp-general-test.h"
+#include "tcp-error-model.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TcpGsoTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the segment-burst transmission mode (GsoMaxSegments)
+ *
+ * The sender builds new data in blocks of up to four segments. On the
+ * wire, every segment must still be at most one MSS, and new data must
+ * follow the previous segment without gaps. One segment is lost: it is
+ * recovered by the fast retransmit, with or without SACK (the mode is
+ * ignored with SACK), and all the data is delivered.
+ */
+class TcpGsoTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param sack true if SACK is enabled
+   * \param desc test description
+   */
+  TcpGsoTest (bool sack, const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<TcpSocketMsgBase> CreateSenderSocket (Ptr<Node> node);
+  virtual Ptr<TcpSocketMsgBase> CreateReceiverSocket (Ptr<Node> node);
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void Tx (const Ptr<const Packet> p, const TcpHeader&h, SocketWho who);
+  virtual void Rx (const Ptr<const Packet> p, const TcpHeader&h, SocketWho who);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_sack;                    //!< SACK enabled
+  SequenceNumber32 m_highTx;      //!< Sequence following the highest data sent
+  uint32_t m_rxBytes;             //!< Payload received, including duplicates
+  bool m_rtoExpired;              //!< The RTO fired
+};
+
+TcpGsoTest::TcpGsoTest (bool sack, const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_sack (sack),
+    m_highTx (1),
+    m_rxBytes (0),
+    m_rtoExpired (false)
+{
+}
+
+void
+TcpGsoTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (40);
+  SetAppPktSize (500);
+  SetAppPktInterval (MicroSeconds (100));
+  SetPropagationDelay (MilliSeconds (10));
+}
+
+void
+TcpGsoTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 2);
+}
+
+Ptr<TcpSocketMsgBase>
+TcpGsoTest::CreateSenderSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateSenderSocket (node);
+  socket->SetAttribute ("GsoMaxSegments", UintegerValue (4));
+  socket->SetAttribute ("Sack", BooleanValue (m_sack));
+  return socket;
+}
+
+Ptr<TcpSocketMsgBase>
+TcpGsoTest::CreateReceiverSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateReceiverSocket (node);
+  socket->SetAttribute ("Sack", BooleanValue (m_sack));
+  return socket;
+}
+
+Ptr<ErrorModel>
+TcpGsoTest::CreateReceiverErrorModel ()
+{
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (5001));
+  return errorModel;
+}
+
+void
+TcpGsoTest::Tx (const Ptr<const Packet> p, const TcpHeader &h, SocketWho who)
+{
+  if (who != SENDER || p->GetSize () == 0)
+    {
+      return;
+    }
+
+  NS_TEST_ASSERT_MSG_LT_OR_EQ (p->GetSize (), GetSegSize (SENDER),
+                               "Segment larger than the MSS on the wire");
+  if (h.GetSequenceNumber () >= m_highTx)
+    {
+      NS_TEST_ASSERT_MSG_EQ (h.GetSequenceNumber (), m_highTx, "Gap in the new data sent");
+      m_highTx = h.GetSequenceNumber () + SequenceNumber32 (p->GetSize ());
+    }
+}
+
+void
+TcpGsoTest::Rx (const Ptr<const Packet> p, const TcpHeader &h, SocketWho who)
+{
+  if (who == RECEIVER)
+    {
+      m_rxBytes += p->GetSize ();
+    }
+}
+
+void
+TcpGsoTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who == SENDER)
+    {
+      m_rtoExpired = true;
+    }
+}
+
+void
+TcpGsoTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_highTx, SequenceNumber32 (1 + 40 * 500), "Not all the data was sent");
+  NS_TEST_ASSERT_MSG_GT_OR_EQ (m_rxBytes, 40u * 500, "Not all the data was delivered");
+  NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, false, "Single loss recovered by the RTO");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the segment-burst transmission mode
+ */
+class TcpGsoTestSuite : public TestSuite
+{
+public:
+  TcpGsoTestSuite () : TestSuite ("tcp-gso", UNIT)
+  {
+    AddTestCase (new TcpGsoTest (false, "Bursts of four segments, without SACK"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpGsoTest (true, "Bursts ignored with SACK"),
+                 TestCase::QUICK);
+  }
+};
+
+static TcpGsoTestSuite g_tcpGsoTest; //!< Static variable for test initialization
@@ -0,0 +1,236 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/tcp-socket-base.h"
+
+#include <algorithm>
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("RttHistoryBufferTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief The RttHistoryBuffer Test
+ *
+ * TcpSocketBase looks for the entry of a retransmitted segment with
+ * RttHistoryBuffer::Find when IndexedRttHistory is true, and with a linear
+ * scan from the front otherwise. Both must return the same entry, also
+ * when retransmissions extended entries over the following ones.
+ */
+class RttHistoryBufferTestCase : public TestCase
+{
+public:
+  RttHistoryBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * \brief Test the search after a retransmission covering several entries
+   */
+  void TestExtendedRetransmission (void);
+
+  /**
+   * \brief Test the search against the linear scan over a long transfer
+   * \param isn the first sequence number of the transfer
+   */
+  void TestEquivalence (uint32_t isn);
+
+  /**
+   * \brief Find an entry as TcpSocketBase does when IndexedRttHistory is false
+   * \param buffer the buffer
+   * \param seq the sequence number
+   * \return the first entry covering seq, 0 if none
+   */
+  RttHistory * LinearFind (RttHistoryBuffer &buffer, const SequenceNumber32 &seq);
+
+  /**
+   * \brief Record a retransmission as TcpSocketBase does
+   * \param buffer the buffer
+   * \param seq the first sequence number retransmitted
+   * \param sz the number of bytes retransmitted
+   */
+  void Retransmit (RttHistoryBuffer &buffer, const SequenceNumber32 &seq, uint32_t sz);
+
+  /**
+   * \brief Check that Find and the linear scan agree on a range of sequence numbers
+   * \param buffer the buffer
+   * \param head the first sequence number to check
+   * \param tail the sequence number following the last one to check
+   */
+  void CheckFind (RttHistoryBuffer &buffer, const SequenceNumber32 &head,
+                  const SequenceNumber32 &tail);
+};
+
+RttHistoryBufferTestCase::RttHistoryBufferTestCase ()
+  : TestCase ("RttHistoryBuffer Test")
+{
+}
+
+void
+RttHistoryBufferTestCase::DoRun ()
+{
+  TestExtendedRetransmission ();
+  TestEquivalence (1);
+  TestEquivalence (0xFFFF0000);
+}
+
+RttHistory *
+RttHistoryBufferTestCase::LinearFind (RttHistoryBuffer &buffer, const SequenceNumber32 &seq)
+{
+  for (uint32_t i = 0; i < buffer.GetSize (); ++i)
+    {
+      RttHistory &entry = buffer.At (i);
+      if ((seq >= entry.seq) && (seq < (entry.seq + SequenceNumber32 (entry.count))))
+        {
+          return &entry;
+        }
+    }
+  return 0;
+}
+
+void
+RttHistoryBufferTestCase::Retransmit (RttHistoryBuffer &buffer, const SequenceNumber32 &seq,
+                                      uint32_t sz)
+{
+  RttHistory *h = buffer.Find (seq);
+  NS_TEST_ASSERT_MSG_EQ (h, LinearFind (buffer, seq), "Retransmission of a different entry");
+  if (h != 0)
+    {
+      h->retx = true;
+      buffer.SetCount (*h, (seq + SequenceNumber32 (sz)) - h->seq);
+    }
+}
+
+void
+RttHistoryBufferTestCase::CheckFind (RttHistoryBuffer &buffer, const SequenceNumber32 &head,
+                                     const SequenceNumber32 &tail)
+{
+  for (SequenceNumber32 seq = head; seq < tail; seq += 50)
+    {
+      NS_TEST_ASSERT_MSG_EQ (buffer.Find (seq), LinearFind (buffer, seq),
+                             "Find and the linear scan differ at " << seq);
+    }
+}
+
+void
+RttHistoryBufferTestCase::TestExtendedRetransmission ()
+{
+  RttHistoryBuffer buffer;
+  buffer.PushBack (RttHistory (SequenceNumber32 (1), 500, Seconds (0)));
+  buffer.PushBack (RttHistory (SequenceNumber32 (501), 500, Seconds (0)));
+  buffer.PushBack (RttHistory (SequenceNumber32 (1001), 500, Seconds (0)));
+
+  // The first segment is retransmitted along with the two following ones:
+  // its entry now covers [1, 1501), the second one still [501, 1001).
+  Retransmit (buffer, SequenceNumber32 (1), 1500);
+  NS_TEST_ASSERT_MSG_EQ (buffer.Front ().count, 1500, "Entry not extended");
+
+  // The second entry does not cover 1200, but the first one does
+  NS_TEST_ASSERT_MSG_EQ (buffer.Find (SequenceNumber32 (1200)), &buffer.At (0),
+                         "Oldest entry covering the sequence not found");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Find (SequenceNumber32 (700)), &buffer.At (0),
+                         "Oldest entry covering the sequence not found");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Find (SequenceNumber32 (1501)), static_cast<RttHistory *> (0),
+                         "Sequence above all the entries found");
+  CheckFind (buffer, SequenceNumber32 (1), SequenceNumber32 (1601));
+
+  // Once the extended entry is acknowledged, the others are found again
+  buffer.PopFront ();
+  NS_TEST_ASSERT_MSG_EQ (buffer.Find (SequenceNumber32 (1200)), &buffer.At (1),
+                         "Entry not found once the extended one is removed");
+  CheckFind (buffer, SequenceNumber32 (1), SequenceNumber32 (1601));
+
+  buffer.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (buffer.IsEmpty (), true, "Cleared buffer not empty");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Find (SequenceNumber32 (1)), static_cast<RttHistory *> (0),
+                         "Entry found in an empty buffer");
+}
+
+void
+RttHistoryBufferTestCase::TestEquivalence (uint32_t isn)
+{
+  // Segments of different sizes are sent, some of them are retransmitted
+  // alone or with the following ones, and the window slides forward, so
+  // that the ring wraps around its slots and grows.
+  static const uint32_t sizes[] = { 500, 1000, 300, 536, 1448 };
+  RttHistoryBuffer buffer;
+  SequenceNumber32 una (isn);
+  SequenceNumber32 next (isn);
+
+  for (uint32_t i = 0; i < 200; ++i)
+    {
+      uint32_t sz = sizes[i % 5];
+      buffer.PushBack (RttHistory (next, sz, Seconds (0)));
+      next += sz;
+
+      if (i % 7 == 3)
+        { // Retransmit from an older entry, up to three segments
+          uint32_t index = (i * 13) % buffer.GetSize ();
+          SequenceNumber32 seq = buffer.At (index).seq;
+          uint32_t len = std::min<uint32_t> (static_cast<uint32_t> (next - seq),
+                                             sizes[i % 3] * (1 + i % 3));
+          Retransmit (buffer, seq, len);
+        }
+      if (i % 11 == 10)
+        { // Retransmit from the middle of an entry
+          uint32_t index = (i * 7) % buffer.GetSize ();
+          SequenceNumber32 seq = buffer.At (index).seq + SequenceNumber32 (100);
+          Retransmit (buffer, seq, 200);
+        }
+
+      CheckFind (buffer, una, next + SequenceNumber32 (100));
+
+      if (i % 4 == 0 && buffer.GetSize () > 8)
+        { // ACK the first entries
+          for (uint32_t j = 0; j < 3; ++j)
+            {
+              una = buffer.Front ().seq + SequenceNumber32 (buffer.Front ().count);
+              buffer.PopFront ();
+            }
+        }
+    }
+}
+
+void
+RttHistoryBufferTestCase::DoTeardown ()
+{
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief the TestSuite for the RttHistoryBuffer test case
+ */
+class RttHistoryBufferTestSuite : public TestSuite
+{
+public:
+  RttHistoryBufferTestSuite ()
+    : TestSuite ("tcp-rtt-history", UNIT)
+  {
+    AddTestCase (new RttHistoryBufferTestCase, TestCase::QUICK);
+  }
+};
+
+static RttHistoryBufferTestSuite g_rttHistoryBufferTestSuite; //!< Static variable for test initialization
@@ -0,0 +1,374 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "ns3/test.h"
+#include "ns3/log.h"
+#include "ns3/tcp-socket-base.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("SeqRangeBufferTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief The SeqRangeBuffer Test
+ */
+class SeqRangeBufferTestCase : public TestCase
+{
+public:
+  SeqRangeBufferTestCase ();
+
+private:
+  virtual void DoRun (void);
+  virtual void DoTeardown (void);
+
+  /**
+   * \brief Test the merge of adjacent and overlapping blocks
+   */
+  void TestMerge (void);
+
+  /**
+   * \brief Test the blocks filling the holes between ranges
+   */
+  void TestHoleFill (void);
+
+  /**
+   * \brief Test the removal of the ranges below the next expected sequence
+   */
+  void TestAdvance (void);
+
+  /**
+   * \brief Test the sequence number wrap-around and the reuse of the slots
+   */
+  void TestWrapAround (void);
+
+  /**
+   * \brief Test the order of the SACK blocks
+   */
+  void TestSackBlocks (void);
+
+  /**
+   * \brief Test that the data filling the hole at the next expected sequence keeps the SACK blocks
+   */
+  void TestInOrderFill (void);
+
+  /**
+   * \brief Check a range of the buffer
+   * \param buffer the buffer
+   * \param i the index of the range
+   * \param first the expected first sequence number
+   * \param second the expected sequence number following the range
+   */
+  void CheckRange (const SeqRangeBuffer &buffer, uint32_t i,
+                   uint32_t first, uint32_t second);
+
+  /**
+   * \brief Check a SACK block of the buffer
+   * \param buffer the buffer
+   * \param i the index of the block
+   * \param first the expected first sequence number
+   * \param second the expected sequence number following the block
+   */
+  void CheckSackBlock (const SeqRangeBuffer &buffer, uint32_t i,
+                       uint32_t first, uint32_t second);
+};
+
+SeqRangeBufferTestCase::SeqRangeBufferTestCase ()
+  : TestCase ("SeqRangeBuffer Test")
+{
+}
+
+void
+SeqRangeBufferTestCase::DoRun ()
+{
+  TestMerge ();
+  TestHoleFill ();
+  TestAdvance ();
+  TestWrapAround ();
+  TestSackBlocks ();
+  TestInOrderFill ();
+}
+
+void
+SeqRangeBufferTestCase::CheckRange (const SeqRangeBuffer &buffer, uint32_t i,
+                                    uint32_t first, uint32_t second)
+{
+  NS_TEST_ASSERT_MSG_EQ (buffer.At (i).first, SequenceNumber32 (first),
+                         "Wrong start of range " << i);
+  NS_TEST_ASSERT_MSG_EQ (buffer.At (i).second, SequenceNumber32 (second),
+                         "Wrong end of range " << i);
+}
+
+void
+SeqRangeBufferTestCase::CheckSackBlock (const SeqRangeBuffer &buffer, uint32_t i,
+                                        uint32_t first, uint32_t second)
+{
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlock (i).first, SequenceNumber32 (first),
+                         "Wrong start of SACK block " << i);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlock (i).second, SequenceNumber32 (second),
+                         "Wrong end of SACK block " << i);
+}
+
+void
+SeqRangeBufferTestCase::TestMerge ()
+{
+  SeqRangeBuffer buffer;
+  NS_TEST_ASSERT_MSG_EQ (buffer.IsEmpty (), true, "New buffer not empty");
+
+  // In-order blocks extend the highest range
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501)), 500,
+                         "Wrong number of new bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1501), SequenceNumber32 (2001)), 500,
+                         "Wrong number of new bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 1, "Adjacent blocks not merged");
+  CheckRange (buffer, 0, 1001, 2001);
+
+  // Overlapping and duplicate blocks count only the new bytes
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1801), SequenceNumber32 (2201)), 200,
+                         "Overlap counted as new data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501)), 0,
+                         "Duplicate counted as new data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (901), SequenceNumber32 (1101)), 100,
+                         "Overlap below the range counted as new data");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 1, "Overlapping blocks not merged");
+  CheckRange (buffer, 0, 901, 2201);
+
+  NS_TEST_ASSERT_MSG_EQ (buffer.Covers (SequenceNumber32 (901), SequenceNumber32 (2201)), true,
+                         "Range does not cover itself");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Covers (SequenceNumber32 (2001), SequenceNumber32 (2301)), false,
+                         "Range covers data above it");
+
+  buffer.Clear ();
+  NS_TEST_ASSERT_MSG_EQ (buffer.IsEmpty (), true, "Cleared buffer not empty");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 0, "SACK blocks not cleared");
+}
+
+void
+SeqRangeBufferTestCase::TestHoleFill ()
+{
+  SeqRangeBuffer buffer;
+  buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501));
+  buffer.Add (SequenceNumber32 (2001), SequenceNumber32 (2501));
+  buffer.Add (SequenceNumber32 (3001), SequenceNumber32 (3501));
+  buffer.Add (SequenceNumber32 (4001), SequenceNumber32 (4501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 4, "Disjoint blocks merged");
+
+  // A block in a hole, touching nothing, is inserted in order
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1601), SequenceNumber32 (1701)), 100,
+                         "Wrong number of new bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 5, "Block in a hole not inserted");
+  CheckRange (buffer, 1, 1601, 1701);
+  CheckRange (buffer, 2, 2001, 2501);
+
+  // A block exactly filling a hole merges the ranges on both sides
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1701), SequenceNumber32 (2001)), 300,
+                         "Wrong number of new bytes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 4, "Hole filled but ranges not merged");
+  CheckRange (buffer, 1, 1601, 2501);
+
+  // A block spanning several ranges and holes merges all of them
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (1401), SequenceNumber32 (3201)),
+                         100 + 500,
+                         "Wrong number of new bytes in the holes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 2, "Spanned ranges not merged");
+  CheckRange (buffer, 0, 1001, 3501);
+  CheckRange (buffer, 1, 4001, 4501);
+  NS_TEST_ASSERT_MSG_EQ (buffer.Covers (SequenceNumber32 (1001), SequenceNumber32 (3501)), true,
+                         "Merged range does not cover the filled holes");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Covers (SequenceNumber32 (3401), SequenceNumber32 (4101)), false,
+                         "Block over a hole reported as covered");
+}
+
+void
+SeqRangeBufferTestCase::TestAdvance ()
+{
+  SeqRangeBuffer buffer;
+  buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501));
+  buffer.Add (SequenceNumber32 (2001), SequenceNumber32 (2501));
+  buffer.Add (SequenceNumber32 (3001), SequenceNumber32 (3501));
+
+  // Below all the ranges: nothing changes
+  buffer.Advance (SequenceNumber32 (501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 3, "Range removed below the next sequence");
+
+  // Past the first range and inside the second one
+  buffer.Advance (SequenceNumber32 (2201));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 2, "Range below the next sequence kept");
+  CheckRange (buffer, 0, 2201, 2501);
+  CheckRange (buffer, 1, 3001, 3501);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 2, "SACK block below the next sequence kept");
+  CheckSackBlock (buffer, 0, 3001, 3501);
+  CheckSackBlock (buffer, 1, 2201, 2501);
+
+  // Exactly at the end of a range
+  buffer.Advance (SequenceNumber32 (2501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 1, "Range ending at the next sequence kept");
+
+  // Past all the ranges
+  buffer.Advance (SequenceNumber32 (5001));
+  NS_TEST_ASSERT_MSG_EQ (buffer.IsEmpty (), true, "Ranges below the next sequence kept");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 0, "SACK blocks below the next sequence kept");
+}
+
+void
+SeqRangeBufferTestCase::TestWrapAround ()
+{
+  SeqRangeBuffer buffer;
+
+  // Ranges across the sequence number wrap-around
+  const uint32_t base = 0xFFFFFC00;
+  buffer.Add (SequenceNumber32 (base), SequenceNumber32 (base + 0x200));
+  buffer.Add (SequenceNumber32 (0x100), SequenceNumber32 (0x200));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 2, "Ranges across the wrap-around merged");
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (base + 0x200), SequenceNumber32 (0x100)),
+                         0x300,
+                         "Wrong number of new bytes across the wrap-around");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 1, "Hole across the wrap-around not filled");
+  CheckRange (buffer, 0, base, 0x200);
+  buffer.Advance (SequenceNumber32 (0x80));
+  CheckRange (buffer, 0, 0x80, 0x200);
+
+  // Slide the ranges so that the ring wraps around its slots, then fill
+  // holes among the wrapped ranges
+  buffer.Clear ();
+  for (uint32_t i = 0; i < 6; ++i)
+    {
+      buffer.Add (SequenceNumber32 (1001 + i * 1000), SequenceNumber32 (1501 + i * 1000));
+    }
+  buffer.Advance (SequenceNumber32 (5001));
+  for (uint32_t i = 6; i < 12; ++i)
+    {
+      buffer.Add (SequenceNumber32 (1001 + i * 1000), SequenceNumber32 (1501 + i * 1000));
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 8, "Wrong number of ranges after the slide");
+  for (uint32_t i = 0; i < 8; ++i)
+    {
+      CheckRange (buffer, i, 5001 + i * 1000, 5501 + i * 1000);
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.Add (SequenceNumber32 (7501), SequenceNumber32 (10001)), 1500,
+                         "Wrong number of new bytes in the wrapped ring");
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 5, "Wrapped ranges not merged");
+  CheckRange (buffer, 1, 6001, 6501);
+  CheckRange (buffer, 2, 7001, 10501);
+  CheckRange (buffer, 3, 11001, 11501);
+  CheckRange (buffer, 4, 12001, 12501);
+
+  // Grow the ring while it is wrapped: the ranges stay in order
+  for (uint32_t i = 12; i < 16; ++i)
+    {
+      buffer.Add (SequenceNumber32 (1001 + i * 1000), SequenceNumber32 (1501 + i * 1000));
+    }
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 9, "Wrong number of ranges after the growth");
+  CheckRange (buffer, 0, 5001, 5501);
+  CheckRange (buffer, 2, 7001, 10501);
+  CheckRange (buffer, 8, 16001, 16501);
+}
+
+void
+SeqRangeBufferTestCase::TestSackBlocks ()
+{
+  SeqRangeBuffer buffer;
+  buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501));
+  buffer.Add (SequenceNumber32 (2001), SequenceNumber32 (2501));
+  buffer.Add (SequenceNumber32 (3001), SequenceNumber32 (3501));
+
+  // Most recent first (RFC 2018)
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 3, "Wrong number of SACK blocks");
+  CheckSackBlock (buffer, 0, 3001, 3501);
+  CheckSackBlock (buffer, 1, 2001, 2501);
+  CheckSackBlock (buffer, 2, 1001, 1501);
+
+  // A block extending an older range moves it to the front
+  buffer.Add (SequenceNumber32 (1501), SequenceNumber32 (1601));
+  CheckSackBlock (buffer, 0, 1001, 1601);
+  CheckSackBlock (buffer, 1, 3001, 3501);
+  CheckSackBlock (buffer, 2, 2001, 2501);
+
+  // A block merging two ranges replaces both of their blocks
+  buffer.Add (SequenceNumber32 (1601), SequenceNumber32 (2001));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 2, "Merged blocks still reported");
+  CheckSackBlock (buffer, 0, 1001, 2501);
+  CheckSackBlock (buffer, 1, 3001, 3501);
+
+  // No more than MAX_SACK_BLOCKS, the oldest ones are dropped
+  buffer.Add (SequenceNumber32 (4001), SequenceNumber32 (4501));
+  buffer.Add (SequenceNumber32 (5001), SequenceNumber32 (5501));
+  buffer.Add (SequenceNumber32 (6001), SequenceNumber32 (6501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), SeqRangeBuffer::MAX_SACK_BLOCKS,
+                         "Too many SACK blocks");
+  CheckSackBlock (buffer, 0, 6001, 6501);
+  CheckSackBlock (buffer, 3, 1001, 2501);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 5, "Range dropped with its SACK block");
+}
+
+void
+SeqRangeBufferTestCase::TestInOrderFill ()
+{
+  SeqRangeBuffer buffer;
+  buffer.Advance (SequenceNumber32 (1));
+  buffer.Add (SequenceNumber32 (1001), SequenceNumber32 (1501));
+  buffer.Add (SequenceNumber32 (2001), SequenceNumber32 (2501));
+  buffer.Add (SequenceNumber32 (3001), SequenceNumber32 (3501));
+  buffer.Add (SequenceNumber32 (4001), SequenceNumber32 (4501));
+  buffer.Add (SequenceNumber32 (5001), SequenceNumber32 (5501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), SeqRangeBuffer::MAX_SACK_BLOCKS,
+                         "Wrong number of SACK blocks");
+  CheckSackBlock (buffer, 3, 2001, 2501);
+
+  // The hole at the next expected sequence is filled: the range becomes in
+  // order and must not push the oldest block out before Advance removes it
+  buffer.Add (SequenceNumber32 (1), SequenceNumber32 (1001));
+  buffer.Advance (SequenceNumber32 (1501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), SeqRangeBuffer::MAX_SACK_BLOCKS,
+                         "Valid SACK block lost when filling the hole");
+  CheckSackBlock (buffer, 0, 5001, 5501);
+  CheckSackBlock (buffer, 3, 2001, 2501);
+
+  // Filling up to a reported block removes that block only
+  buffer.Add (SequenceNumber32 (1501), SequenceNumber32 (2001));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 3, "Block now in order still reported");
+  buffer.Advance (SequenceNumber32 (2501));
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSackBlockCount (), 3, "Wrong number of SACK blocks");
+  CheckSackBlock (buffer, 0, 5001, 5501);
+  CheckSackBlock (buffer, 2, 3001, 3501);
+  NS_TEST_ASSERT_MSG_EQ (buffer.GetSize (), 3, "In-order ranges not removed");
+}
+
+void
+SeqRangeBufferTestCase::DoTeardown ()
+{
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief the TestSuite for the SeqRangeBuffer test case
+ */
+class SeqRangeBufferTestSuite : public TestSuite
+{
+public:
+  SeqRangeBufferTestSuite ()
+    : TestSuite ("tcp-seq-range-buffer", UNIT)
+  {
+    AddTestCase (new SeqRangeBufferTestCase, TestCase::QUICK);
+  }
+};
+
+static SeqRangeBufferTestSuite g_seqRangeBufferTestSuite; //!< Static variable for test initialization
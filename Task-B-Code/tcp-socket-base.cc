@@ -147,6 +147,43 @@ TcpSocketBase::GetTypeId (void)
                    BooleanValue (true),
                    MakeBooleanAccessor (&TcpSocketBase::m_limitedTx),
                    MakeBooleanChecker ())
+    .AddAttribute ("IndexedRttHistory",
+                   "Find the retransmitted segments in the RTT history with a binary "
+                   "search (false: linear scan, for validation)",
+                   BooleanValue (true),
+                   MakeBooleanAccessor (&TcpSocketBase::m_indexedRttHistory),
+                   MakeBooleanChecker ())
+    .AddAttribute ("EmptyPacketPoolSize",
+                   "Number of packets recycled for the empty segments (0 to disable)",
+                   UintegerValue (8),
+                   MakeUintegerAccessor (&TcpSocketBase::m_emptyPacketPoolSize),
+                   MakeUintegerChecker<uint32_t> ())
+    .AddAttribute ("EmptyPacketPoolHits",
+                   "Number of empty segments built from a recycled packet",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TcpSocketBase::GetEmptyPacketPoolHits),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("EmptyPacketPoolMisses",
+                   "Number of empty segments that needed a new packet",
+                   TypeId::ATTR_GET,
+                   UintegerValue (0),
+                   MakeUintegerAccessor (&TcpSocketBase::GetEmptyPacketPoolMisses),
+                   MakeUintegerChecker<uint64_t> ())
+    .AddAttribute ("TimeBasedLossDetection",
+                   "Detect the losses from the send times of the segments (RACK) "
+                   "and send a tail loss probe (TLP), instead of waiting for "
+                   "three duplicate ACKs or the RTO (requires SACK)",
+                   BooleanValue (false),
+                   MakeBooleanAccessor (&TcpSocketBase::m_timeBasedLossDetection),
+                   MakeBooleanChecker ())
+    .AddAttribute ("GsoMaxSegments",
+                   "Maximum number of segments of new data built at once, as a "
+                   "single burst split in MSS-sized segments (1 to disable). "
+                   "Only used with SACK and pacing disabled",
+                   UintegerValue (1),
+                   MakeUintegerAccessor (&TcpSocketBase::m_gsoMaxSegments),
+                   MakeUintegerChecker<uint32_t> (1, 64))
     .AddAttribute ("UseEcn", "Parameter to set ECN functionality",
                    EnumValue (TcpSocketState::Off),
                    MakeEnumAccessor (&TcpSocketBase::SetUseEcn),
@@ -263,47 +300,7 @@ TcpSocketBase::TcpSocketBase (void)
 
   m_tcb->m_sendEmptyPacketCallback = MakeCallback (&TcpSocketBase::SendEmptyPacket, this);
 
-  bool ok;
-
-  ok = m_tcb->TraceConnectWithoutContext ("PacingRate",
-                                          MakeCallback (&TcpSocketBase::UpdatePacingRateTrace, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongestionWindow",
-                                          MakeCallback (&TcpSocketBase::UpdateCwnd, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongestionWindowInflated",
-                                          MakeCallback (&TcpSocketBase::UpdateCwndInfl, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("SlowStartThreshold",
-                                          MakeCallback (&TcpSocketBase::UpdateSsThresh, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongState",
-                                          MakeCallback (&TcpSocketBase::UpdateCongState, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("EcnState",
-                                          MakeCallback (&TcpSocketBase::UpdateEcnState, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("NextTxSequence",
-                                          MakeCallback (&TcpSocketBase::UpdateNextTxSequence, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("HighestSequence",
-                                          MakeCallback (&TcpSocketBase::UpdateHighTxMark, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("BytesInFlight",
-                                          MakeCallback (&TcpSocketBase::UpdateBytesInFlight, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("RTT",
-                                          MakeCallback (&TcpSocketBase::UpdateRtt, this));
-  NS_ASSERT (ok == true);
+  SetTcbTraceSources ();
 }
 
 TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
@@ -323,6 +320,10 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
     m_delAckTimeout (sock.m_delAckTimeout),
     m_persistTimeout (sock.m_persistTimeout),
     m_cnTimeout (sock.m_cnTimeout),
+    m_emptyPacketPoolSize (sock.m_emptyPacketPoolSize),
+    m_indexedRttHistory (sock.m_indexedRttHistory),
+    m_gsoMaxSegments (sock.m_gsoMaxSegments),
+    m_timeBasedLossDetection (sock.m_timeBasedLossDetection),
     m_endPoint (nullptr),
     m_endPoint6 (nullptr),
     m_node (sock.m_node),
@@ -398,46 +399,7 @@ TcpSocketBase::TcpSocketBase (const TcpSocketBase& sock)
       m_tcb->m_sendEmptyPacketCallback = MakeCallback (&TcpSocketBase::SendEmptyPacket, this);
     }
 
-  bool ok;
-
-  ok = m_tcb->TraceConnectWithoutContext ("PacingRate",
-                                          MakeCallback (&TcpSocketBase::UpdatePacingRateTrace, this));
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongestionWindow",
-                                          MakeCallback (&TcpSocketBase::UpdateCwnd, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongestionWindowInflated",
-                                          MakeCallback (&TcpSocketBase::UpdateCwndInfl, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("SlowStartThreshold",
-                                          MakeCallback (&TcpSocketBase::UpdateSsThresh, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("CongState",
-                                          MakeCallback (&TcpSocketBase::UpdateCongState, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("EcnState",
-                                          MakeCallback (&TcpSocketBase::UpdateEcnState, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("NextTxSequence",
-                                          MakeCallback (&TcpSocketBase::UpdateNextTxSequence, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("HighestSequence",
-                                          MakeCallback (&TcpSocketBase::UpdateHighTxMark, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("BytesInFlight",
-                                          MakeCallback (&TcpSocketBase::UpdateBytesInFlight, this));
-  NS_ASSERT (ok == true);
-
-  ok = m_tcb->TraceConnectWithoutContext ("RTT",
-                                          MakeCallback (&TcpSocketBase::UpdateRtt, this));
-  NS_ASSERT (ok == true);
+  SetTcbTraceSources ();
 }
 
 TcpSocketBase::~TcpSocketBase (void)
@@ -466,6 +428,8 @@ TcpSocketBase::~TcpSocketBase (void)
       NS_ASSERT (m_endPoint6 == nullptr);
     }
   m_tcp = 0;
+  // No data-sent notification from a socket being destroyed
+  m_dataSentEvent.Cancel ();
   CancelAllTimers ();
 }
 
@@ -1294,7 +1258,10 @@ TcpSocketBase::DoForwardUp (Ptr<Packet> packet, const Address &fromAddress,
         }
     }
 
-  m_rxTrace (packet, tcpHeader, this);
+  if (!m_rxTrace.IsEmpty ())
+    {
+      m_rxTrace (packet, tcpHeader, this);
+    }
 
   if (tcpHeader.GetFlags () & TcpHeader::SYN)
     {
@@ -1410,7 +1377,10 @@ TcpSocketBase::DoForwardUp (Ptr<Packet> packet, const Address &fromAddress,
           h.SetDestinationPort (tcpHeader.GetSourcePort ());
           h.SetWindowSize (AdvertisedWindowSize ());
           AddOptions (h);
-          m_txTrace (p, h, this);
+          if (!m_txTrace.IsEmpty ())
+            {
+              m_txTrace (p, h, this);
+            }
           m_tcp->SendPacket (p, h, toAddress, fromAddress, m_boundnetdevice);
         }
       break;
@@ -1550,7 +1520,9 @@ TcpSocketBase::ReadOptions (const TcpHeader &tcpHeader, uint32_t *bytesSacked)
 {
   NS_LOG_FUNCTION (this << tcpHeader);
   TcpHeader::TcpOptionList::const_iterator it;
-  const TcpHeader::TcpOptionList options = tcpHeader.GetOptionList ();
+  // Walk the list in place: copying it costs an allocation and a
+  // reference count update per option, on every ACK
+  const TcpHeader::TcpOptionList &options = tcpHeader.GetOptionList ();
 
   for (it = options.begin (); it != options.end (); ++it)
     {
@@ -1606,6 +1578,9 @@ TcpSocketBase::EnterRecovery (uint32_t currentDelivered)
   NS_LOG_DEBUG (TcpSocketState::TcpCongStateName[m_tcb->m_congState] <<
                 " -> CA_RECOVERY");
 
+  m_rackEvent.Cancel ();
+  m_tlpEvent.Cancel ();
+
   if (!m_sackEnabled)
     {
       // One segment has left the network, PLUS the head is lost
@@ -1636,16 +1611,21 @@ TcpSocketBase::EnterRecovery (uint32_t currentDelivered)
   // If SACK is not enabled, still consider the head as 'in flight' for
   // compatibility with old ns-3 versions
   uint32_t bytesInFlight = m_sackEnabled ? BytesInFlight () : BytesInFlight () + m_tcb->m_segmentSize;
-  m_tcb->m_ssThresh = m_congestionControl->GetSsThresh (m_tcb, bytesInFlight);
-  
-  //---added---
-  if(m_tcb->m_oldcWnd > 0){
-     bytesInFlight=m_tcb->m_oldcWnd;
-     m_tcb->m_oldcWnd=-1;
-  }
-  //-----------
-  
-  if (!m_congestionControl->HasCongControl ())
+  TcpCongestionOps::LossResponse response =
+    m_congestionControl->GetLossResponse (m_tcb, bytesInFlight);
+  m_tcb->m_ssThresh = response.ssThresh;
+  m_keepCwnd = response.keepCwnd;
+
+  if (m_keepCwnd)
+    {
+      // Non-congestive loss: the recovery only retransmits, the recovery
+      // algorithm neither deflates nor inflates the window
+      m_tcb->m_cWndInfl = m_tcb->m_cWnd;
+      NS_LOG_INFO (m_dupAckCount << " dupack. Enter fast recovery mode, "
+                   "window kept at " << m_tcb->m_cWnd << ", ssthresh to " <<
+                   m_tcb->m_ssThresh << " at fast recovery seqnum " << m_recover);
+    }
+  else if (!m_congestionControl->HasCongControl ())
     {
       m_recoveryOps->EnterRecovery (m_tcb, m_dupAckCount, UnAckDataCount (), currentDelivered);
       NS_LOG_INFO (m_dupAckCount << " dupack. Enter fast recovery mode." <<
@@ -1706,7 +1686,7 @@ TcpSocketBase::DupAck (uint32_t currentDelivered)
           // has left the network. This is equivalent to a SACK of one block.
           m_txBuffer->AddRenoSack ();
         }
-      if (!m_congestionControl->HasCongControl ())
+      if (!m_congestionControl->HasCongControl () && !m_keepCwnd)
         {
           m_recoveryOps->DoRecovery (m_tcb, currentDelivered);
           NS_LOG_INFO (m_dupAckCount << " Dupack received in fast recovery mode."
@@ -1748,6 +1728,15 @@ TcpSocketBase::DupAck (uint32_t currentDelivered)
           EnterRecovery (currentDelivered);
           NS_ASSERT (m_tcb->m_congState == TcpSocketState::CA_RECOVERY);
         }
+      // (RACK) If a segment sent after the head has been delivered, and the
+      // head is still not acknowledged one RTT plus the reordering window
+      // after its transmission, go to step (4) without waiting for more
+      // dupacks: with a small window, they may never arrive.
+      else if (m_timeBasedLossDetection && m_sackEnabled && RackDetectLoss (currentDelivered))
+        {
+          EnterRecovery (currentDelivered);
+          NS_ASSERT (m_tcb->m_congState == TcpSocketState::CA_RECOVERY);
+        }
       else
         {
           // (3) The TCP MAY transmit previously unsent data segments as per
@@ -1768,6 +1757,131 @@ TcpSocketBase::DupAck (uint32_t currentDelivered)
     }
 }
 
+void
+TcpSocketBase::RackDelivered (const RttHistory &h)
+{
+  if (h.retx && Simulator::Now () - h.lastSent < m_tcb->m_minRtt)
+    {
+      return;
+    }
+  // Segments sent at the same time are ordered by their end sequence
+  SequenceNumber32 endSeq = h.seq + SequenceNumber32 (h.count);
+  if (h.lastSent > m_rackXmitTime
+      || (h.lastSent == m_rackXmitTime && endSeq > m_rackEndSeq))
+    {
+      m_rackXmitTime = h.lastSent;
+      m_rackEndSeq = endSeq;
+    }
+}
+
+bool
+TcpSocketBase::RackDetectLoss (uint32_t currentDelivered)
+{
+  NS_LOG_FUNCTION (this << currentDelivered);
+
+  // As with the dupacks, do not enter the recovery again for the data
+  // of the last congestion event, nor without an RTT sample
+  if (m_history.IsEmpty () || (m_recoverActive && m_highRxAckMark < m_recover)
+      || m_tcb->m_lastRtt.Get ().IsZero ())
+    {
+      return false;
+    }
+
+  // The oldest entry holds SND.UNA, unless the history has been emptied
+  // by an RTO
+  const RttHistory &head = m_history.Front ();
+  if (head.seq > m_txBuffer->HeadSequence () || m_rackXmitTime < head.lastSent
+      || (m_rackXmitTime == head.lastSent
+          && m_rackEndSeq <= head.seq + SequenceNumber32 (head.count)))
+    {
+      return false;
+    }
+
+  Time reoWnd = Seconds (0.0);
+  if (m_tcb->m_minRtt != Time::Max ())
+    {
+      reoWnd = NanoSeconds (m_tcb->m_minRtt.GetNanoSeconds () / 4);
+    }
+  Time deadline = head.lastSent + m_tcb->m_lastRtt.Get () + reoWnd;
+  if (Simulator::Now () >= deadline)
+    {
+      NS_LOG_DEBUG ("RACK: head " << m_txBuffer->HeadSequence () << " sent at " <<
+                    head.lastSent.GetSeconds () << " is lost");
+      m_rackEvent.Cancel ();
+      return true;
+    }
+
+  if (!m_rackEvent.IsRunning ())
+    {
+      NS_LOG_LOGIC ("RACK: check the head again at " << deadline.GetSeconds ());
+      // The bytes (S)ACKed from this ACK to the expiration are the
+      // delivered count of the recovery, if it is entered
+      m_rackDelivered = m_rateOps->GetConnectionRate ().m_delivered - currentDelivered;
+      m_rackEvent = Simulator::Schedule (deadline - Simulator::Now (),
+                                         &TcpSocketBase::RackTimeout, this);
+    }
+  return false;
+}
+
+void
+TcpSocketBase::RackTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  uint32_t delivered = static_cast<uint32_t> (m_rateOps->GetConnectionRate ().m_delivered - m_rackDelivered);
+  if (m_tcb->m_congState == TcpSocketState::CA_DISORDER && RackDetectLoss (delivered))
+    {
+      EnterRecovery (delivered);
+      NS_ASSERT (m_tcb->m_congState == TcpSocketState::CA_RECOVERY);
+      SendPendingData (m_connected);
+    }
+}
+
+void
+TcpSocketBase::ArmTlp (void)
+{
+  NS_LOG_FUNCTION (this);
+  m_tlpEvent.Cancel ();
+
+  if (!m_sackEnabled || m_tcb->m_congState != TcpSocketState::CA_OPEN
+      || m_tcb->m_highTxMark.Get () <= m_txBuffer->HeadSequence ()
+      || m_rtt->GetEstimate ().IsZero ())
+    {
+      return;
+    }
+
+  Time pto = m_rtt->GetEstimate () * 2;
+  if (static_cast<uint32_t> (m_tcb->m_highTxMark.Get () - m_txBuffer->HeadSequence ()) <= m_tcb->m_segmentSize)
+    {
+      // A single segment in flight: its ACK may be delayed
+      pto += m_delAckTimeout;
+    }
+  if (m_retxEvent.IsRunning () && pto >= Simulator::GetDelayLeft (m_retxEvent))
+    {
+      return;
+    }
+  m_tlpEvent = Simulator::Schedule (pto, &TcpSocketBase::TlpTimeout, this);
+}
+
+void
+TcpSocketBase::TlpTimeout (void)
+{
+  NS_LOG_FUNCTION (this);
+  if (m_tcb->m_congState != TcpSocketState::CA_OPEN
+      || m_tcb->m_highTxMark.Get () <= m_txBuffer->HeadSequence ())
+    {
+      return;
+    }
+
+  uint32_t outstanding = static_cast<uint32_t> (m_tcb->m_highTxMark.Get () - m_txBuffer->HeadSequence ());
+  SequenceNumber32 probe = m_txBuffer->HeadSequence ();
+  if (outstanding > m_tcb->m_segmentSize)
+    {
+      probe = probe + SequenceNumber32 (outstanding - m_tcb->m_segmentSize);
+    }
+  NS_LOG_INFO ("Tail loss probe: retransmit " << probe);
+  SendDataPacket (probe, m_tcb->m_segmentSize, m_connected);
+}
+
 /* Process the newly received ACK */
 void
 TcpSocketBase::ReceivedAck (Ptr<Packet> packet, const TcpHeader& tcpHeader)
@@ -2007,7 +2121,7 @@ TcpSocketBase::ProcessAck(const SequenceNumber32 &ackNumber, bool scoreboardUpda
 
           // Before retransmitting the packet perform DoRecovery and check if
           // there is available window
-          if (!m_congestionControl->HasCongControl () && segsAcked >= 1)
+          if (!m_congestionControl->HasCongControl () && !m_keepCwnd && segsAcked >= 1)
             {
               m_recoveryOps->DoRecovery (m_tcb, currentDelivered);
             }
@@ -2016,7 +2130,10 @@ TcpSocketBase::ProcessAck(const SequenceNumber32 &ackNumber, bool scoreboardUpda
           if (!m_txBuffer->IsRetransmittedDataAcked (ackNumber + m_tcb->m_segmentSize))
             {
               DoRetransmit (); // Assume the next seq is lost. Retransmit lost packet
-              m_tcb->m_cWndInfl = SafeSubtraction (m_tcb->m_cWndInfl, bytesAcked);
+              if (!m_keepCwnd)
+                {
+                  m_tcb->m_cWndInfl = SafeSubtraction (m_tcb->m_cWndInfl, bytesAcked);
+                }
             }
 
           // This partial ACK acknowledge the fact that one segment has been
@@ -2157,8 +2274,17 @@ TcpSocketBase::ProcessAck(const SequenceNumber32 &ackNumber, bool scoreboardUpda
           if (exitedFastRecovery)
             {
               NewAck (ackNumber, true);
-              m_tcb->m_cWnd = m_tcb->m_ssThresh.Get ();
-              m_recoveryOps->ExitRecovery (m_tcb);
+              if (m_keepCwnd)
+                {
+                  // Non-congestive loss: the window was not deflated
+                  m_tcb->m_cWndInfl = m_tcb->m_cWnd;
+                  m_keepCwnd = false;
+                }
+              else
+                {
+                  m_tcb->m_cWnd = m_tcb->m_ssThresh.Get ();
+                  m_recoveryOps->ExitRecovery (m_tcb);
+                }
               NS_LOG_DEBUG ("Leaving Fast Recovery; BytesInFlight() = " <<
                             BytesInFlight () << "; cWnd = " << m_tcb->m_cWnd);
             }
@@ -2680,7 +2806,7 @@ TcpSocketBase::SendEmptyPacket (uint8_t flags)
       return;
     }
 
-  Ptr<Packet> p = Create<Packet> ();
+  Ptr<Packet> p = GetEmptyPacket ();
   TcpHeader header;
   SequenceNumber32 s = m_tcb->m_nextTxSequence;
 
@@ -2767,8 +2893,6 @@ TcpSocketBase::SendEmptyPacket (uint8_t flags)
           m_highTxAck = header.GetAckNumber (); 
         }
       
-      m_tcb->m_highTxAck=m_highTxAck; // ---added
-      
       if (m_sackEnabled && m_tcb->m_rxBuffer->GetSackListSize () > 0)
         {
           AddOptionSack (header);
@@ -2776,7 +2900,10 @@ TcpSocketBase::SendEmptyPacket (uint8_t flags)
       NS_LOG_INFO ("Sending a pure ACK, acking seq " << m_tcb->m_rxBuffer->NextRxSequence ());
     }
 
-  m_txTrace (p, header, this);
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (p, header, this);
+    }
 
   if (m_endPoint != nullptr)
     {
@@ -2962,6 +3089,45 @@ TcpSocketBase::ConnectionSucceeded ()
     }
 }
 
+Ptr<Packet>
+TcpSocketBase::GetEmptyPacket (void)
+{
+  for (std::vector<Ptr<Packet> >::iterator it = m_emptyPacketPool.begin ();
+       it != m_emptyPacketPool.end (); ++it)
+    {
+      Ptr<Packet> p = *it;
+      if (p->GetReferenceCount () == 2)
+        { // Only the pool and p: the lower layers are done with it.
+          // Reset it as a new packet: empty buffer, no tags, and a new
+          // UID, so that the traces do not see two packets with the same
+          // UID. Only the allocation of the Packet object is saved.
+          *p = Packet ();
+          ++m_emptyPacketPoolHits;
+          return p;
+        }
+    }
+
+  ++m_emptyPacketPoolMisses;
+  Ptr<Packet> p = Create<Packet> ();
+  if (m_emptyPacketPool.size () < m_emptyPacketPoolSize)
+    {
+      m_emptyPacketPool.push_back (p);
+    }
+  return p;
+}
+
+uint64_t
+TcpSocketBase::GetEmptyPacketPoolHits (void) const
+{
+  return m_emptyPacketPoolHits;
+}
+
+uint64_t
+TcpSocketBase::GetEmptyPacketPoolMisses (void) const
+{
+  return m_emptyPacketPoolMisses;
+}
+
 void
 TcpSocketBase::AddSocketTags (const Ptr<Packet> &p) const
 {
@@ -3043,7 +3209,9 @@ TcpSocketBase::AddSocketTags (const Ptr<Packet> &p) const
 }
 
 /* Extract at most maxSize bytes from the TxBuffer at sequence seq, add the
-    TCP header, and send to TcpL4Protocol */
+    TCP header, and send to TcpL4Protocol. A block larger than one segment
+    (segment-burst mode) is split here in MSS-sized segments, which share
+    the header built for the whole block. */
 uint32_t
 TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool withAck)
 {
@@ -3055,8 +3223,12 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
   m_rateOps->SkbSent(outItem, isStartOfTransmission);
 
   bool isRetransmission = outItem->IsRetrans ();
-  Ptr<Packet> p = outItem->GetPacketCopy ();
-  uint32_t sz = p->GetSize (); // Size of packet
+  // The segments share the payload of the TxItem (Packet is copy-on-write);
+  // each one only needs its own Packet object, for the socket tags and the
+  // headers of the lower layers. A segment burst is sliced directly from
+  // the TxItem, without an intermediate copy of the whole block.
+  Ptr<const Packet> block = outItem->GetPacket ();
+  uint32_t sz = block->GetSize (); // Size of packet
   uint8_t flags = withAck ? TcpHeader::ACK : 0;
   uint32_t remainingData = m_txBuffer->SizeFromSequence (seq + SequenceNumber32 (sz));
 
@@ -3098,8 +3270,6 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
       NS_LOG_INFO ("CWR flags set");
     }
 
-  AddSocketTags (p);
-
   if (m_closeOnEmpty && (remainingData == 0))
     {
       flags |= TcpHeader::FIN;
@@ -3141,44 +3311,96 @@ TcpSocketBase::SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool with
       m_retxEvent = Simulator::Schedule (m_rto, &TcpSocketBase::ReTxTimeout, this);
     }
 
-  m_txTrace (p, header, this);
-
-  if (m_endPoint)
+  if (sz <= m_tcb->m_segmentSize)
     {
-      m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (),
-                         m_endPoint->GetPeerAddress (), m_boundnetdevice);
-      NS_LOG_DEBUG ("Send segment of size " << sz << " with remaining data " <<
-                    remainingData << " via TcpL4Protocol to " <<  m_endPoint->GetPeerAddress () <<
-                    ". Header " << header);
+      Ptr<Packet> p = outItem->GetPacketCopy ();
+      AddSocketTags (p);
+      SendSegment (p, header, remainingData);
+      UpdateRttHistory (seq, sz, isRetransmission);
     }
   else
     {
-      m_tcp->SendPacket (p, header, m_endPoint6->GetLocalAddress (),
-                         m_endPoint6->GetPeerAddress (), m_boundnetdevice);
-      NS_LOG_DEBUG ("Send segment of size " << sz << " with remaining data " <<
-                    remainingData << " via TcpL4Protocol to " <<  m_endPoint6->GetPeerAddress () <<
-                    ". Header " << header);
+      // Segment burst: FIN goes with the last segment, CWR with the first one
+      uint32_t offset = 0;
+      while (offset < sz)
+        {
+          uint32_t segSize = std::min (sz - offset, m_tcb->m_segmentSize);
+          TcpHeader segHeader = header;
+          uint8_t segFlags = flags;
+          if (offset > 0)
+            {
+              segFlags &= ~TcpHeader::CWR;
+            }
+          if (offset + segSize < sz)
+            {
+              segFlags &= ~TcpHeader::FIN;
+            }
+          segHeader.SetFlags (segFlags);
+          segHeader.SetSequenceNumber (seq + offset);
+          Ptr<Packet> p = block->CreateFragment (offset, segSize);
+          AddSocketTags (p);
+          SendSegment (p, segHeader, remainingData + sz - offset - segSize);
+          // One RTT entry per segment, as if they were sent one by one, so
+          // that an ACK of the first segments already gives an RTT sample
+          UpdateRttHistory (seq + offset, segSize, isRetransmission);
+          offset += segSize;
+        }
     }
 
-  UpdateRttHistory (seq, sz, isRetransmission);
-
   // Update bytes sent during recovery phase
   if (m_tcb->m_congState == TcpSocketState::CA_RECOVERY || m_tcb->m_congState == TcpSocketState::CA_CWR)
     {
       m_recoveryOps->UpdateBytesSent (sz);
     }
 
-  // Notify the application of the data being sent unless this is a retransmit
+  // Notify the application of the data being sent unless this is a retransmit.
+  // The segments sent in the same event share a single notification.
   if (!isRetransmission)
     {
-      Simulator::ScheduleNow (&TcpSocketBase::NotifyDataSent, this,
-                              (seq + sz - m_tcb->m_highTxMark.Get ()));
+      m_dataSentBytes += (seq + sz - m_tcb->m_highTxMark.Get ());
+      if (!m_dataSentEvent.IsRunning ())
+        {
+          m_dataSentEvent = Simulator::ScheduleNow (&TcpSocketBase::NotifyPendingDataSent, this);
+        }
     }
   // Update highTxMark
   m_tcb->m_highTxMark = std::max (seq + sz, m_tcb->m_highTxMark.Get ());
+
+  if (m_timeBasedLossDetection && !isRetransmission)
+    {
+      ArmTlp ();
+    }
   return sz;
 }
 
+void
+TcpSocketBase::SendSegment (Ptr<Packet> p, const TcpHeader &header, uint32_t remainingData)
+{
+  NS_LOG_FUNCTION (this << p << header << remainingData);
+
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (p, header, this);
+    }
+
+  if (m_endPoint)
+    {
+      m_tcp->SendPacket (p, header, m_endPoint->GetLocalAddress (),
+                         m_endPoint->GetPeerAddress (), m_boundnetdevice);
+      NS_LOG_DEBUG ("Send segment of size " << p->GetSize () << " with remaining data " <<
+                    remainingData << " via TcpL4Protocol to " <<  m_endPoint->GetPeerAddress () <<
+                    ". Header " << header);
+    }
+  else
+    {
+      m_tcp->SendPacket (p, header, m_endPoint6->GetLocalAddress (),
+                         m_endPoint6->GetPeerAddress (), m_boundnetdevice);
+      NS_LOG_DEBUG ("Send segment of size " << p->GetSize () << " with remaining data " <<
+                    remainingData << " via TcpL4Protocol to " <<  m_endPoint6->GetPeerAddress () <<
+                    ". Header " << header);
+    }
+}
+
 void
 TcpSocketBase::UpdateRttHistory (const SequenceNumber32 &seq, uint32_t sz,
                                  bool isRetransmission)
@@ -3188,19 +3410,33 @@ TcpSocketBase::UpdateRttHistory (const SequenceNumber32 &seq, uint32_t sz,
   // update the history of sequence numbers used to calculate the RTT
   if (isRetransmission == false)
     { // This is the next expected one, just log at end
-      m_history.push_back (RttHistory (seq, sz, Simulator::Now ()));
+      m_history.PushBack (RttHistory (seq, sz, Simulator::Now ()));
     }
   else
     { // This is a retransmit, find in list and mark as re-tx
-      for (std::deque<RttHistory>::iterator i = m_history.begin (); i != m_history.end (); ++i)
+      RttHistory *h = 0;
+      if (m_indexedRttHistory)
         {
-          if ((seq >= i->seq) && (seq < (i->seq + SequenceNumber32 (i->count))))
-            { // Found it
-              i->retx = true;
-              i->count = ((seq + SequenceNumber32 (sz)) - i->seq); // And update count in hist
-              break;
+          h = m_history.Find (seq);
+        }
+      else
+        {
+          for (uint32_t i = 0; i < m_history.GetSize (); ++i)
+            {
+              RttHistory &entry = m_history.At (i);
+              if ((seq >= entry.seq) && (seq < (entry.seq + SequenceNumber32 (entry.count))))
+                {
+                  h = &entry;
+                  break;
+                }
             }
         }
+      if (h != 0)
+        { // Found it
+          h->retx = true;
+          m_history.SetCount (*h, (seq + SequenceNumber32 (sz)) - h->seq); // And update count in hist
+          h->lastSent = Simulator::Now ();
+        }
     }
 }
 
@@ -3293,6 +3529,27 @@ TcpSocketBase::SendPendingData (bool withAck)
           uint32_t maxSizeToSend = static_cast<uint32_t> (nextHigh - next);
           s = std::min (s, maxSizeToSend);
 
+          // Segment-burst mode: new data is sent as a block of several full
+          // segments, split by SendDataPacket. Retransmissions and paced
+          // flows keep sending one segment at a time. The block is a single
+          // TxItem, which the scoreboard marks as a whole: a SACK block
+          // covering part of it would not mark it as SACKed, so the mode is
+          // not used while SACK is enabled.
+          if (m_gsoMaxSegments > 1 && (m_sackEnabled || IsPacingEnabled ())
+              && !m_gsoIgnoredWarned)
+            {
+              NS_LOG_WARN ("GsoMaxSegments " << m_gsoMaxSegments <<
+                           " ignored: SACK or pacing is enabled");
+              m_gsoIgnoredWarned = true;
+            }
+          if (m_gsoMaxSegments > 1 && !m_sackEnabled && s == m_tcb->m_segmentSize
+              && next == m_tcb->m_highTxMark && !IsPacingEnabled ())
+            {
+              uint64_t burst = std::min (availableWindow, availableData);
+              burst = std::min (burst, static_cast<uint64_t> (m_gsoMaxSegments) * m_tcb->m_segmentSize);
+              s = std::max (s, static_cast<uint32_t> (burst - burst % m_tcb->m_segmentSize));
+            }
+
           // (C.2) If any of the data octets sent in (C.1) are below HighData,
           //       HighRxt MUST be set to the highest sequence number of the
           //       retransmitted segment unless NextSeg () rule (4) was
@@ -3538,11 +3795,10 @@ TcpSocketBase::EstimateRtt (const TcpHeader& tcpHeader)
   Time m = Time (0.0);
 
   // An ack has been received, calculate rtt and log this measurement
-  // Note we use a linear search (O(n)) for this since for the common
-  // case the ack'ed packet will be at the head of the list
-  if (!m_history.empty ())
+  // from the segment at the head of the list
+  if (!m_history.IsEmpty ())
     {
-      RttHistory& h = m_history.front ();
+      RttHistory& h = m_history.Front ();
       if (!h.retx && ackSeq >= (h.seq + SequenceNumber32 (h.count)))
         { // Ok to use this sample
           if (m_timestampEnabled && tcpHeader.HasOption (TcpOption::TS))
@@ -3563,15 +3819,20 @@ TcpSocketBase::EstimateRtt (const TcpHeader& tcpHeader)
         }
     }
 
-  // Now delete all ack history with seq <= ack
-  while (!m_history.empty ())
+  // Now delete all ack history with seq <= ack. Each entry is removed
+  // once, by moving the head of the ring: O(1) per acknowledged segment
+  while (!m_history.IsEmpty ())
     {
-      RttHistory& h = m_history.front ();
+      RttHistory& h = m_history.Front ();
       if ((h.seq + SequenceNumber32 (h.count)) > ackSeq)
         {
           break;                                                              // Done removing
         }
-      m_history.pop_front (); // Remove
+      if (m_timeBasedLossDetection)
+        {
+          RackDelivered (h);
+        }
+      m_history.PopFront (); // Remove
     }
 
   if (!m.IsZero ())
@@ -3611,6 +3872,11 @@ TcpSocketBase::NewAck (SequenceNumber32 const& ack, bool resetRTO)
       m_retxEvent = Simulator::Schedule (m_rto, &TcpSocketBase::ReTxTimeout, this);
     }
 
+  if (m_timeBasedLossDetection)
+    {
+      ArmTlp ();
+    }
+
   // Note the highest ACK and tell app to send more
   NS_LOG_LOGIC ("TCP " << this << " NewAck " << ack <<
                 " numberAck " << (ack - m_txBuffer->HeadSequence ())); // Number bytes ack'ed
@@ -3711,6 +3977,8 @@ TcpSocketBase::ReTxTimeout ()
   // will be retransmitted, if the receiver renegotiate the SACK blocks
   // that we received.
   m_txBuffer->SetSentListLost (resetSack);
+  m_rackEvent.Cancel ();
+  m_tlpEvent.Cancel ();
 
   // From RFC 6675, Section 5.1
   // If an RTO occurs during loss recovery as specified in this document,
@@ -3725,23 +3993,39 @@ TcpSocketBase::ReTxTimeout ()
   m_rto = Min (doubledRto, Time::FromDouble (60,  Time::S));
 
   // Empty RTT history
-  m_history.clear ();
+  m_history.Clear ();
 
   // Please don't reset highTxMark, it is used for retransmission detection
 
   // When a TCP sender detects segment loss using the retransmission timer
   // and the given segment has not yet been resent by way of the
-  // retransmission timer, decrease ssThresh
+  // retransmission timer, decrease ssThresh. The congestion control may
+  // decide that the timeout is not congestive.
+  bool keepCwnd = false;
+  m_keepCwnd = false;
   if (m_tcb->m_congState != TcpSocketState::CA_LOSS || !m_txBuffer->IsHeadRetransmitted ())
     {
-      m_tcb->m_ssThresh = m_congestionControl->GetSsThresh (m_tcb, inFlightBeforeRto);
+      TcpCongestionOps::LossResponse response =
+        m_congestionControl->GetLossResponse (m_tcb, inFlightBeforeRto);
+      m_tcb->m_ssThresh = response.ssThresh;
+      keepCwnd = response.keepCwnd;
     }
 
-  // Cwnd set to 1 MSS
   m_congestionControl->CwndEvent (m_tcb, TcpSocketState::CA_EVENT_LOSS);
   m_congestionControl->CongestionStateSet (m_tcb, TcpSocketState::CA_LOSS);
   m_tcb->m_congState = TcpSocketState::CA_LOSS;
-  m_tcb->m_cWnd = m_tcb->m_segmentSize;
+  if (keepCwnd)
+    {
+      // Non-congestive timeout: restart from half of ssThresh (whole
+      // segments, at least one), instead of a full slow start
+      m_tcb->m_cWnd = std::max (m_tcb->m_segmentSize,
+                                m_tcb->m_ssThresh.Get () / 2 / m_tcb->m_segmentSize * m_tcb->m_segmentSize);
+    }
+  else
+    {
+      // Cwnd set to 1 MSS
+      m_tcb->m_cWnd = m_tcb->m_segmentSize;
+    }
   m_tcb->m_cWndInfl = m_tcb->m_cWnd;
 
   m_pacingTimer.Cancel ();
@@ -3836,7 +4120,10 @@ TcpSocketBase::PersistTimeout ()
       ipTclassTag.SetTclass (MarkEcnCodePoint (0, m_tcb->m_ectCodePoint));
       p->AddPacketTag (ipTclassTag);
     }
-  m_txTrace (p, tcpHeader, this);
+  if (!m_txTrace.IsEmpty ())
+    {
+      m_txTrace (p, tcpHeader, this);
+    }
 
   if (m_endPoint != nullptr)
     {
@@ -3900,6 +4187,14 @@ TcpSocketBase::CancelAllTimers ()
   m_timewaitEvent.Cancel ();
   m_sendPendingDataEvent.Cancel ();
   m_pacingTimer.Cancel ();
+  m_rackEvent.Cancel ();
+  m_tlpEvent.Cancel ();
+  if (m_dataSentEvent.IsRunning ())
+    {
+      // The data was sent: notify it now instead of losing the count
+      m_dataSentEvent.Cancel ();
+      NotifyPendingDataSent ();
+    }
 }
 
 /* Move TCP to Time_Wait state and schedule a transition to Closed state */
@@ -4173,7 +4468,27 @@ TcpSocketBase::ProcessOptionSack (const Ptr<const TcpOption> option)
   NS_LOG_FUNCTION (this << option);
 
   Ptr<const TcpOptionSack> s = DynamicCast<const TcpOptionSack> (option);
-  return m_txBuffer->Update (s->GetSackList (), MakeCallback (&TcpRateOps::SkbDelivered, m_rateOps));
+  TcpOptionSack::SackList sackList = s->GetSackList ();
+  uint32_t bytesSacked = m_txBuffer->Update (sackList, MakeCallback (&TcpRateOps::SkbDelivered, m_rateOps));
+
+  if (m_timeBasedLossDetection)
+    {
+      TcpOptionSack::SackList::const_iterator it;
+      for (it = sackList.begin (); it != sackList.end (); ++it)
+        {
+          if (it->first >= it->second)
+            {
+              continue;
+            }
+          // The last segment of the block is the most recently sent
+          RttHistory *h = m_history.Find (it->second - 1);
+          if (h != 0)
+            {
+              RackDelivered (*h);
+            }
+        }
+    }
+  return bytesSacked;
 }
 
 void
@@ -4215,16 +4530,20 @@ TcpSocketBase::AddOptionSack (TcpHeader& header)
     }
 
   // Append the allowed number of SACK blocks
-  Ptr<TcpOptionSack> option = CreateObject<TcpOptionSack> ();
-  TcpOptionSack::SackList::iterator i;
+  if (!m_sackOption || m_sackOption->GetReferenceCount () > 1)
+    { // Still referenced by a previous header (e.g. kept by a trace sink)
+      m_sackOption = CreateObject<TcpOptionSack> ();
+    }
+  m_sackOption->ClearSackList ();
+  TcpOptionSack::SackList::const_iterator i;
   for (i = sackList.begin (); allowedSackBlocks > 0 && i != sackList.end (); ++i)
     {
-      option->AddSackBlock (*i);
+      m_sackOption->AddSackBlock (*i);
       allowedSackBlocks--;
     }
 
-  header.AppendOption (option);
-  NS_LOG_INFO (m_node->GetId () << " Add option SACK " << *option);
+  header.AppendOption (m_sackOption);
+  NS_LOG_INFO (m_node->GetId () << " Add option SACK " << *m_sackOption);
 }
 
 void
@@ -4260,14 +4579,20 @@ TcpSocketBase::AddOptionTimestamp (TcpHeader& header)
 {
   NS_LOG_FUNCTION (this << header);
 
-  Ptr<TcpOptionTS> option = CreateObject<TcpOptionTS> ();
+  // The header is serialized in the packet before the next segment is
+  // built, so the same option object is reused for every segment, unless
+  // someone (e.g. a trace sink) still holds the previous header
+  if (!m_tsOption || m_tsOption->GetReferenceCount () > 1)
+    {
+      m_tsOption = CreateObject<TcpOptionTS> ();
+    }
 
-  option->SetTimestamp (TcpOptionTS::NowToTsValue ());
-  option->SetEcho (m_timestampToEcho);
+  m_tsOption->SetTimestamp (TcpOptionTS::NowToTsValue ());
+  m_tsOption->SetEcho (m_timestampToEcho);
 
-  header.AppendOption (option);
+  header.AppendOption (m_tsOption);
   NS_LOG_INFO (m_node->GetId () << " Add option TS, ts=" <<
-               option->GetTimestamp () << " echo=" << m_timestampToEcho);
+               m_tsOption->GetTimestamp () << " echo=" << m_timestampToEcho);
 }
 
 void TcpSocketBase::UpdateWindowSize (const TcpHeader &header)
@@ -4359,6 +4684,31 @@ TcpSocketBase::SetRetxThresh (uint32_t retxThresh)
   m_txBuffer->SetDupAckThresh (retxThresh);
 }
 
+void
+TcpSocketBase::SetTcbTraceSources (void)
+{
+  m_pacingRateTrace.SetSource (&m_tcb->m_pacingRate,
+                               MakeCallback (&TcpSocketBase::UpdatePacingRateTrace, this));
+  m_cWndTrace.SetSource (&m_tcb->m_cWnd,
+                         MakeCallback (&TcpSocketBase::UpdateCwnd, this));
+  m_cWndInflTrace.SetSource (&m_tcb->m_cWndInfl,
+                             MakeCallback (&TcpSocketBase::UpdateCwndInfl, this));
+  m_ssThTrace.SetSource (&m_tcb->m_ssThresh,
+                         MakeCallback (&TcpSocketBase::UpdateSsThresh, this));
+  m_congStateTrace.SetSource (&m_tcb->m_congState,
+                              MakeCallback (&TcpSocketBase::UpdateCongState, this));
+  m_ecnStateTrace.SetSource (&m_tcb->m_ecnState,
+                             MakeCallback (&TcpSocketBase::UpdateEcnState, this));
+  m_nextTxSequenceTrace.SetSource (&m_tcb->m_nextTxSequence,
+                                   MakeCallback (&TcpSocketBase::UpdateNextTxSequence, this));
+  m_highTxMarkTrace.SetSource (&m_tcb->m_highTxMark,
+                               MakeCallback (&TcpSocketBase::UpdateHighTxMark, this));
+  m_bytesInFlightTrace.SetSource (&m_tcb->m_bytesInFlight,
+                                  MakeCallback (&TcpSocketBase::UpdateBytesInFlight, this));
+  m_lastRttTrace.SetSource (&m_tcb->m_lastRtt,
+                            MakeCallback (&TcpSocketBase::UpdateRtt, this));
+}
+
 void
 TcpSocketBase::UpdatePacingRateTrace (DataRate oldValue, DataRate newValue)
 {
@@ -4463,6 +4813,15 @@ TcpSocketBase::NotifyPacingPerformed (void)
   SendPendingData (m_connected);
 }
 
+void
+TcpSocketBase::NotifyPendingDataSent (void)
+{
+  NS_LOG_FUNCTION (this << m_dataSentBytes);
+  uint32_t bytes = m_dataSentBytes;
+  m_dataSentBytes = 0;
+  NotifyDataSent (bytes);
+}
+
 bool
 TcpSocketBase::IsPacingEnabled (void) const
 {
@@ -4504,22 +4863,32 @@ TcpSocketBase::UpdatePacingRate (void)
   // congestion control implements TcpCongestionOps::CongControl ()
   if (m_congestionControl->HasCongControl () || !m_tcb->m_pacing) return;
 
-  double factor;
-  if (m_tcb->m_cWnd < m_tcb->m_ssThresh/2)
+  DataRate pacingRate;
+  if (m_tcb->m_ccPacingRate.GetBitRate () > 0)
     {
-      NS_LOG_DEBUG ("Pacing according to slow start factor; " << m_tcb->m_cWnd << " " << m_tcb->m_ssThresh);
-      factor = static_cast<double> (m_tcb->m_pacingSsRatio)/100;
+      // The congestion control derives the rate from its own state
+      NS_LOG_DEBUG ("Pacing according to the congestion control");
+      pacingRate = m_tcb->m_ccPacingRate;
     }
   else
     {
-      NS_LOG_DEBUG ("Pacing according to congestion avoidance factor; " << m_tcb->m_cWnd << " " << m_tcb->m_ssThresh);
-      factor = static_cast<double> (m_tcb->m_pacingCaRatio)/100;
+      double factor;
+      if (m_tcb->m_cWnd < m_tcb->m_ssThresh/2)
+        {
+          NS_LOG_DEBUG ("Pacing according to slow start factor; " << m_tcb->m_cWnd << " " << m_tcb->m_ssThresh);
+          factor = static_cast<double> (m_tcb->m_pacingSsRatio)/100;
+        }
+      else
+        {
+          NS_LOG_DEBUG ("Pacing according to congestion avoidance factor; " << m_tcb->m_cWnd << " " << m_tcb->m_ssThresh);
+          factor = static_cast<double> (m_tcb->m_pacingCaRatio)/100;
+        }
+      Time lastRtt = m_tcb->m_lastRtt.Get (); // Get underlying Time value
+      NS_LOG_DEBUG ("Last RTT is " << lastRtt.GetSeconds ());
+
+      // Multiply by 8 to convert from bytes per second to bits per second
+      pacingRate = DataRate ((std::max (m_tcb->m_cWnd, m_tcb->m_bytesInFlight) * 8 * factor) / lastRtt.GetSeconds ());
     }
-  Time lastRtt = m_tcb->m_lastRtt.Get (); // Get underlying Time value
-  NS_LOG_DEBUG ("Last RTT is " << lastRtt.GetSeconds ());
-  
-  // Multiply by 8 to convert from bytes per second to bits per second
-  DataRate pacingRate ((std::max (m_tcb->m_cWnd, m_tcb->m_bytesInFlight) * 8 * factor) / lastRtt.GetSeconds ());
   if (pacingRate < m_tcb->m_maxPacingRate)
     {
       NS_LOG_DEBUG ("Pacing rate updated to: " << pacingRate);
@@ -4571,7 +4940,8 @@ RttHistory::RttHistory (SequenceNumber32 s, uint32_t c, Time t)
   : seq (s),
     count (c),
     time (t),
-    retx (false)
+    retx (false),
+    lastSent (t)
 {
 }
 
@@ -4579,8 +4949,398 @@ RttHistory::RttHistory (const RttHistory& h)
   : seq (h.seq),
     count (h.count),
     time (h.time),
-    retx (h.retx)
+    retx (h.retx),
+    lastSent (h.lastSent)
+{
+}
+
+//RttHistoryBuffer methods
+RttHistoryBuffer::RttHistoryBuffer ()
+  : m_head (0),
+    m_size (0),
+    m_maxCount (0)
+{
+}
+
+void
+RttHistoryBuffer::PushBack (const RttHistory &h)
+{
+  NS_ASSERT (m_size == 0 || h.seq >= At (m_size - 1).seq);
+
+  if (m_size == m_slots.size ())
+    { // Full: double the ring, moving the entries in order at its beginning
+      std::vector<RttHistory> slots;
+      std::size_t capacity = std::max<std::size_t> (2 * m_slots.size (), 16);
+      slots.reserve (capacity);
+      for (uint32_t i = 0; i < m_size; ++i)
+        {
+          slots.push_back (At (i));
+        }
+      slots.resize (capacity, h); // Free slots, overwritten when used
+      m_slots.swap (slots);
+      m_head = 0;
+    }
+
+  uint32_t slot = m_head + m_size;
+  if (slot >= m_slots.size ())
+    {
+      slot -= m_slots.size ();
+    }
+  m_slots[slot] = h;
+  ++m_size;
+  m_maxCount = std::max (m_maxCount, h.count);
+}
+
+void
+RttHistoryBuffer::PopFront (void)
+{
+  NS_ASSERT (m_size > 0);
+  if (++m_head == m_slots.size ())
+    {
+      m_head = 0;
+    }
+  --m_size;
+}
+
+RttHistory &
+RttHistoryBuffer::Front (void)
+{
+  NS_ASSERT (m_size > 0);
+  return m_slots[m_head];
+}
+
+RttHistory &
+RttHistoryBuffer::At (uint32_t i)
 {
+  NS_ASSERT (i < m_size);
+  uint32_t slot = m_head + i;
+  if (slot >= m_slots.size ())
+    {
+      slot -= m_slots.size ();
+    }
+  return m_slots[slot];
+}
+
+uint32_t
+RttHistoryBuffer::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+RttHistoryBuffer::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+void
+RttHistoryBuffer::Clear (void)
+{
+  m_head = 0;
+  m_size = 0;
+  m_maxCount = 0;
+}
+
+void
+RttHistoryBuffer::SetCount (RttHistory &h, uint32_t count)
+{
+  h.count = count;
+  m_maxCount = std::max (m_maxCount, count);
+}
+
+RttHistory *
+RttHistoryBuffer::Find (const SequenceNumber32 &seq)
+{
+  // The entries are sorted by sequence number: look for the first one
+  // starting after seq
+  uint32_t low = 0;
+  uint32_t high = m_size;
+  while (low < high)
+    {
+      uint32_t mid = low + (high - low) / 2;
+      if (At (mid).seq > seq)
+        {
+          high = mid;
+        }
+      else
+        {
+          low = mid + 1;
+        }
+    }
+
+  // A retransmission larger than the original segment extends the entry
+  // over the following ones, so an older entry may cover seq even if a
+  // newer one does not: walk back to the oldest entry covering seq, until
+  // the entries start too far below seq to reach it.
+  RttHistory *found = 0;
+  for (uint32_t i = low; i > 0; --i)
+    {
+      RttHistory &h = At (i - 1);
+      if (seq >= (h.seq + SequenceNumber32 (m_maxCount)))
+        {
+          break;
+        }
+      if (seq < (h.seq + SequenceNumber32 (h.count)))
+        {
+          found = &h;
+        }
+    }
+  return found;
+}
+
+SeqRangeBuffer::SeqRangeBuffer ()
+  : m_head (0),
+    m_size (0),
+    m_sackBlockCount (0),
+    m_nextRxSeq (0),
+    m_nextRxSeqKnown (false)
+{
+}
+
+uint32_t
+SeqRangeBuffer::Add (const SequenceNumber32 &head, const SequenceNumber32 &tail)
+{
+  NS_ASSERT (head < tail);
+  uint32_t length = static_cast<uint32_t> (tail - head);
+
+  if (m_size == 0 || head > At (m_size - 1).second)
+    { // Beyond the highest range
+      Insert (m_size, Range (head, tail));
+      UpdateSackBlocks (Range (head, tail));
+      return length;
+    }
+
+  Range &last = m_slots[Slot (m_size - 1)];
+  if (head >= last.first)
+    { // Extends the highest range
+      uint32_t added = 0;
+      if (tail > last.second)
+        {
+          added = static_cast<uint32_t> (tail - last.second);
+          last.second = tail;
+        }
+      UpdateSackBlocks (last);
+      return added;
+    }
+
+  // Fills a hole: look for the first range ending at or after head
+  uint32_t low = 0;
+  uint32_t high = m_size;
+  while (low < high)
+    {
+      uint32_t mid = low + (high - low) / 2;
+      if (At (mid).second < head)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  // Merge the block with the ranges it overlaps or touches
+  Range merged (head, tail);
+  uint32_t covered = 0;
+  uint32_t end = low;
+  while (end < m_size && At (end).first <= tail)
+    {
+      const Range &r = At (end);
+      SequenceNumber32 overlapHead = std::max (r.first, head);
+      SequenceNumber32 overlapTail = std::min (r.second, tail);
+      if (overlapHead < overlapTail)
+        {
+          covered += static_cast<uint32_t> (overlapTail - overlapHead);
+        }
+      merged.first = std::min (merged.first, r.first);
+      merged.second = std::max (merged.second, r.second);
+      ++end;
+    }
+
+  if (end == low)
+    {
+      Insert (low, merged);
+    }
+  else
+    {
+      m_slots[Slot (low)] = merged;
+      Erase (low + 1, end);
+    }
+  UpdateSackBlocks (merged);
+  return length - covered;
+}
+
+void
+SeqRangeBuffer::Advance (const SequenceNumber32 &nextRxSeq)
+{
+  m_nextRxSeq = nextRxSeq;
+  m_nextRxSeqKnown = true;
+  while (m_size > 0 && m_slots[m_head].second <= nextRxSeq)
+    {
+      if (++m_head == m_slots.size ())
+        {
+          m_head = 0;
+        }
+      --m_size;
+    }
+  if (m_size > 0 && m_slots[m_head].first < nextRxSeq)
+    {
+      m_slots[m_head].first = nextRxSeq;
+    }
+
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < m_sackBlockCount; ++i)
+    {
+      Range block = m_sackBlocks[i];
+      if (block.second <= nextRxSeq)
+        {
+          continue;
+        }
+      if (block.first < nextRxSeq)
+        {
+          block.first = nextRxSeq;
+        }
+      m_sackBlocks[count++] = block;
+    }
+  m_sackBlockCount = count;
+}
+
+const SeqRangeBuffer::Range &
+SeqRangeBuffer::At (uint32_t i) const
+{
+  NS_ASSERT (i < m_size);
+  return m_slots[Slot (i)];
+}
+
+uint32_t
+SeqRangeBuffer::GetSize (void) const
+{
+  return m_size;
+}
+
+bool
+SeqRangeBuffer::Covers (const SequenceNumber32 &head, const SequenceNumber32 &tail) const
+{
+  // Look for the first range ending at or after tail
+  uint32_t low = 0;
+  uint32_t high = m_size;
+  while (low < high)
+    {
+      uint32_t mid = low + (high - low) / 2;
+      if (At (mid).second < tail)
+        {
+          low = mid + 1;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+  return low < m_size && At (low).first <= head;
+}
+
+bool
+SeqRangeBuffer::IsEmpty (void) const
+{
+  return m_size == 0;
+}
+
+void
+SeqRangeBuffer::Clear (void)
+{
+  m_head = 0;
+  m_size = 0;
+  m_sackBlockCount = 0;
+  m_nextRxSeqKnown = false;
+}
+
+uint32_t
+SeqRangeBuffer::GetSackBlockCount (void) const
+{
+  return m_sackBlockCount;
+}
+
+const SeqRangeBuffer::Range &
+SeqRangeBuffer::GetSackBlock (uint32_t i) const
+{
+  NS_ASSERT (i < m_sackBlockCount);
+  return m_sackBlocks[i];
+}
+
+void
+SeqRangeBuffer::UpdateSackBlocks (const Range &r)
+{
+  // A range starting at the next expected sequence number is in order:
+  // the next Advance removes it, it must not push out an older block
+  bool inOrder = m_nextRxSeqKnown && r.first <= m_nextRxSeq;
+
+  // Keep the blocks outside of r, shifted by one to make room at the front
+  Range blocks[MAX_SACK_BLOCKS];
+  uint32_t count = 0;
+  if (!inOrder)
+    {
+      blocks[count++] = r;
+    }
+  for (uint32_t i = 0; i < m_sackBlockCount && count < MAX_SACK_BLOCKS; ++i)
+    {
+      const Range &block = m_sackBlocks[i];
+      if (block.second < r.first || block.first > r.second)
+        {
+          blocks[count++] = block;
+        }
+    }
+  std::copy (blocks, blocks + count, m_sackBlocks);
+  m_sackBlockCount = count;
+}
+
+uint32_t
+SeqRangeBuffer::Slot (uint32_t i) const
+{
+  uint32_t slot = m_head + i;
+  if (slot >= m_slots.size ())
+    {
+      slot -= m_slots.size ();
+    }
+  return slot;
+}
+
+void
+SeqRangeBuffer::Insert (uint32_t i, const Range &r)
+{
+  NS_ASSERT (i <= m_size);
+
+  if (m_size == m_slots.size ())
+    { // Full: double the ring, moving the ranges in order at its beginning
+      std::vector<Range> slots;
+      std::size_t capacity = std::max<std::size_t> (2 * m_slots.size (), 8);
+      slots.reserve (capacity);
+      for (uint32_t j = 0; j < m_size; ++j)
+        {
+          slots.push_back (At (j));
+        }
+      slots.resize (capacity, r); // Free slots, overwritten when used
+      m_slots.swap (slots);
+      m_head = 0;
+    }
+
+  ++m_size;
+  for (uint32_t j = m_size - 1; j > i; --j)
+    {
+      m_slots[Slot (j)] = m_slots[Slot (j - 1)];
+    }
+  m_slots[Slot (i)] = r;
+}
+
+void
+SeqRangeBuffer::Erase (uint32_t first, uint32_t last)
+{
+  NS_ASSERT (first <= last && last <= m_size);
+  uint32_t count = last - first;
+  for (uint32_t j = last; j < m_size; ++j)
+    {
+      m_slots[Slot (j - count)] = m_slots[Slot (j)];
+    }
+  m_size -= count;
 }
 
 } // namespace ns3
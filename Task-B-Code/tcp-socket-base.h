@@ -23,6 +23,8 @@
 
 #include <stdint.h>
 #include <queue>
+#include <utility>
+#include <vector>
 #include "ns3/traced-value.h"
 #include "ns3/tcp-socket.h"
 #include "ns3/ipv4-header.h"
@@ -47,6 +49,8 @@ class RttEstimator;
 class TcpRxBuffer;
 class TcpTxBuffer;
 class TcpOption;
+class TcpOptionTS;
+class TcpOptionSack;
 class Ipv4Interface;
 class Ipv6Interface;
 class TcpRateOps;
@@ -76,8 +80,380 @@ public:
   uint32_t        count;  //!< Number of bytes sent
   Time            time;   //!< Time this one was sent
   bool            retx;   //!< True if this has been retransmitted
+  Time            lastSent; //!< Time of the last transmission, retransmissions included
 };
 
+/**
+ * \ingroup tcp
+ *
+ * \brief Ring buffer of RttHistory entries, indexed by sequence number
+ *
+ * The entries are appended in sequence number order (only new data is
+ * appended, retransmissions update the existing entries) and removed from
+ * the front when acknowledged, so that the buffer is a sliding window
+ * over the sent segments. The slots are reused once the window slides:
+ * after the first window no memory is allocated.
+ *
+ * Being sorted, the buffer is searched with a binary search when a
+ * segment is retransmitted, instead of a linear scan.
+ */
+class RttHistoryBuffer
+{
+public:
+  RttHistoryBuffer ();
+
+  /**
+   * \brief Append an entry after the last one
+   * \param h the entry, its sequence number must not be lower than the last one
+   */
+  void PushBack (const RttHistory &h);
+
+  /**
+   * \brief Remove the oldest entry
+   */
+  void PopFront (void);
+
+  /**
+   * \brief Get the oldest entry
+   * \return the oldest entry
+   */
+  RttHistory & Front (void);
+
+  /**
+   * \brief Get an entry, from the oldest one
+   * \param i the index of the entry, 0 being the oldest
+   * \return the entry
+   */
+  RttHistory & At (uint32_t i);
+
+  /**
+   * \brief Get the number of entries
+   * \return the number of entries
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * \brief Check if the buffer is empty
+   * \return true if there are no entries
+   */
+  bool IsEmpty (void) const;
+
+  /**
+   * \brief Remove all the entries, keeping the slots
+   */
+  void Clear (void);
+
+  /**
+   * \brief Change the number of bytes of an entry
+   *
+   * A retransmission may cover more than the original segment, so that
+   * the entry overlaps the following ones. The count must be changed
+   * through the buffer, which bounds the search of Find with it.
+   *
+   * \param h the entry
+   * \param count the new number of bytes
+   */
+  void SetCount (RttHistory &h, uint32_t count);
+
+  /**
+   * \brief Find the entry of the segment holding a sequence number
+   *
+   * This is the entry found by a linear scan from the front, even when a
+   * retransmission extended an entry over the following ones. The binary
+   * search is followed by a walk back over the entries starting less than
+   * the largest count before seq.
+   *
+   * \param seq the sequence number
+   * \return the oldest entry covering seq, 0 if none
+   */
+  RttHistory * Find (const SequenceNumber32 &seq);
+
+private:
+  std::vector<RttHistory> m_slots; //!< Slots of the ring
+  uint32_t m_head;                 //!< Slot of the oldest entry
+  uint32_t m_size;                 //!< Number of entries
+  uint32_t m_maxCount;             //!< Largest count of the entries since the last Clear
+};
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Sorted ring of disjoint sequence number ranges
+ *
+ * Each entry is a contiguous range [first, second) of data received above
+ * the next expected sequence number. The ranges are disjoint and not
+ * adjacent: a block filling the space between two ranges merges them.
+ * The socket does not keep a copy of the out-of-order data of TcpRxBuffer:
+ * its SACK list stays the only view of the receive side.
+ *
+ * Segments usually arrive in order, or extend the highest range: these
+ * are appended or merged at the back in O(1). A segment filling a hole is
+ * located with a binary search. Once the next expected sequence number
+ * moves forward, the ranges below it are removed from the front.
+ *
+ * The SACK blocks to advertise are maintained along with the ranges, most
+ * recent first (RFC 2018): the range holding the last block received,
+ * then the ranges of the previous blocks, up to MAX_SACK_BLOCKS.
+ */
+class SeqRangeBuffer
+{
+public:
+  /**
+   * \brief A range of received data, [first, second)
+   */
+  typedef std::pair<SequenceNumber32, SequenceNumber32> Range;
+
+  /**
+   * \brief Maximum number of SACK blocks, as many as fit in the TCP options
+   */
+  static const uint32_t MAX_SACK_BLOCKS = 4;
+
+  SeqRangeBuffer ();
+
+  /**
+   * \brief Record the reception of a block of data
+   * \param head the first sequence number of the block
+   * \param tail the sequence number following the block
+   * \return the number of bytes of the block not covered by the ranges
+   */
+  uint32_t Add (const SequenceNumber32 &head, const SequenceNumber32 &tail);
+
+  /**
+   * \brief Remove the data below the next expected sequence number
+   * \param nextRxSeq the next expected sequence number
+   */
+  void Advance (const SequenceNumber32 &nextRxSeq);
+
+  /**
+   * \brief Check if a block is entirely covered by a range
+   * \param head the first sequence number of the block
+   * \param tail the sequence number following the block
+   * \return true if [head, tail) is part of a single range
+   */
+  bool Covers (const SequenceNumber32 &head, const SequenceNumber32 &tail) const;
+
+  /**
+   * \brief Get a range, from the lowest one
+   * \param i the index of the range, 0 being the lowest
+   * \return the range
+   */
+  const Range & At (uint32_t i) const;
+
+  /**
+   * \brief Get the number of ranges
+   * \return the number of ranges
+   */
+  uint32_t GetSize (void) const;
+
+  /**
+   * \brief Check if there is no out-of-order data
+   * \return true if there are no ranges
+   */
+  bool IsEmpty (void) const;
+
+  /**
+   * \brief Remove all the ranges, keeping the slots, and forget the next expected sequence number
+   */
+  void Clear (void);
+
+  /**
+   * \brief Get the number of SACK blocks
+   * \return the number of SACK blocks, at most MAX_SACK_BLOCKS
+   */
+  uint32_t GetSackBlockCount (void) const;
+
+  /**
+   * \brief Get a SACK block, from the most recent one
+   * \param i the index of the block, 0 being the most recent
+   * \return the block
+   */
+  const Range & GetSackBlock (uint32_t i) const;
+
+private:
+  /**
+   * \brief Move the range of the last block received to the front of the SACK blocks
+   *
+   * The blocks covered by the range (merged into it) are removed. A range
+   * starting at or below the last value given to Advance is in order and
+   * is not inserted.
+   *
+   * \param r the range holding the last block received
+   */
+  void UpdateSackBlocks (const Range &r);
+
+  /**
+   * \brief Get the slot of a range
+   * \param i the index of the range, 0 being the lowest
+   * \return the slot index in m_slots
+   */
+  uint32_t Slot (uint32_t i) const;
+
+  /**
+   * \brief Insert a range, moving the following ones towards the back
+   * \param i the index of the new range
+   * \param r the range
+   */
+  void Insert (uint32_t i, const Range &r);
+
+  /**
+   * \brief Remove the ranges [first, last), moving the following ones
+   * \param first the index of the first range to remove
+   * \param last the index following the last range to remove
+   */
+  void Erase (uint32_t first, uint32_t last);
+
+  std::vector<Range> m_slots; //!< Slots of the ring
+  uint32_t m_head;            //!< Slot of the lowest range
+  uint32_t m_size;            //!< Number of ranges
+  Range m_sackBlocks[MAX_SACK_BLOCKS]; //!< SACK blocks, most recent first
+  uint32_t m_sackBlockCount;           //!< Number of SACK blocks
+  SequenceNumber32 m_nextRxSeq;        //!< Last value given to Advance
+  bool m_nextRxSeqKnown;               //!< Advance was called since the last Clear
+};
+
+/**
+ * \ingroup tcp
+ *
+ * \brief Trace source of the socket fed by a TracedValue of TcpSocketState
+ *
+ * The forwarding callback (one of the Update* functions of the socket) is
+ * connected to the TracedValue when the first sink is connected, and
+ * disconnected after the last sink is removed. This holds for the sinks
+ * connected through the TypeId (TraceConnect, Config::Connect) and for the
+ * ones connected to the member directly, since both call the functions of
+ * this class. The changes of a value nobody traces only cost the empty
+ * check of the TracedValue.
+ */
+template <typename T>
+class TcpSocketStateTrace : public TracedCallback<T, T>
+{
+public:
+  TcpSocketStateTrace ();
+
+  /**
+   * \brief Set the traced value to forward, connecting it if sinks are already there
+   * \param source the traced value of the TcpSocketState
+   * \param forward the function firing this trace source
+   */
+  void SetSource (TracedValue<T> *source, const Callback<void, T, T> &forward);
+
+  /**
+   * \brief Append a sink, starting the forwarding before the first one
+   * \param callback the sink
+   */
+  void ConnectWithoutContext (const CallbackBase &callback);
+
+  /**
+   * \brief Append a sink with a context, starting the forwarding before the first one
+   * \param callback the sink
+   * \param path the context of the sink
+   */
+  void Connect (const CallbackBase &callback, std::string path);
+
+  /**
+   * \brief Remove a sink, stopping the forwarding after the last one
+   * \param callback the sink
+   */
+  void DisconnectWithoutContext (const CallbackBase &callback);
+
+  /**
+   * \brief Remove a sink with a context, stopping the forwarding after the last one
+   * \param callback the sink
+   * \param path the context of the sink
+   */
+  void Disconnect (const CallbackBase &callback, std::string path);
+
+private:
+  /**
+   * \brief Connect the forwarding to the traced value, if not done yet
+   */
+  void StartForwarding (void);
+
+  /**
+   * \brief Disconnect the forwarding if there are no sinks left
+   */
+  void StopForwarding (void);
+
+  TracedValue<T> *m_source;       //!< Traced value of the TcpSocketState
+  Callback<void, T, T> m_forward; //!< Function firing this trace source
+  bool m_forwarding;              //!< The forwarding is connected to m_source
+};
+
+template <typename T>
+TcpSocketStateTrace<T>::TcpSocketStateTrace ()
+  : TracedCallback<T, T> (),
+    m_source (0),
+    m_forwarding (false)
+{
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::SetSource (TracedValue<T> *source, const Callback<void, T, T> &forward)
+{
+  NS_ASSERT (!m_forwarding);
+  m_source = source;
+  m_forward = forward;
+  if (!this->IsEmpty ())
+    {
+      StartForwarding ();
+    }
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::ConnectWithoutContext (const CallbackBase &callback)
+{
+  StartForwarding ();
+  TracedCallback<T, T>::ConnectWithoutContext (callback);
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::Connect (const CallbackBase &callback, std::string path)
+{
+  StartForwarding ();
+  TracedCallback<T, T>::Connect (callback, path);
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::DisconnectWithoutContext (const CallbackBase &callback)
+{
+  TracedCallback<T, T>::DisconnectWithoutContext (callback);
+  StopForwarding ();
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::Disconnect (const CallbackBase &callback, std::string path)
+{
+  TracedCallback<T, T>::Disconnect (callback, path);
+  StopForwarding ();
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::StartForwarding (void)
+{
+  if (!m_forwarding && m_source != 0)
+    {
+      m_source->ConnectWithoutContext (m_forward);
+      m_forwarding = true;
+    }
+}
+
+template <typename T>
+void
+TcpSocketStateTrace<T>::StopForwarding (void)
+{
+  if (m_forwarding && this->IsEmpty ())
+    {
+      m_source->DisconnectWithoutContext (m_forward);
+      m_forwarding = false;
+    }
+}
+
 /**
  * \ingroup socket
  * \ingroup tcp
@@ -322,52 +698,52 @@ public:
   /**
    * \brief Callback pointer for pacing rate trace chaining
    */
-  TracedCallback<DataRate, DataRate>  m_pacingRateTrace;
+  TcpSocketStateTrace<DataRate> m_pacingRateTrace;
 
   /**
    * \brief Callback pointer for cWnd trace chaining
    */
-  TracedCallback<uint32_t, uint32_t> m_cWndTrace;
+  TcpSocketStateTrace<uint32_t> m_cWndTrace;
 
   /**
    * \brief Callback pointer for cWndInfl trace chaining
    */
-  TracedCallback<uint32_t, uint32_t> m_cWndInflTrace;
+  TcpSocketStateTrace<uint32_t> m_cWndInflTrace;
 
   /**
    * \brief Callback pointer for ssTh trace chaining
    */
-  TracedCallback<uint32_t, uint32_t> m_ssThTrace;
+  TcpSocketStateTrace<uint32_t> m_ssThTrace;
 
   /**
    * \brief Callback pointer for congestion state trace chaining
    */
-  TracedCallback<TcpSocketState::TcpCongState_t, TcpSocketState::TcpCongState_t> m_congStateTrace;
+  TcpSocketStateTrace<TcpSocketState::TcpCongState_t> m_congStateTrace;
 
    /**
    * \brief Callback pointer for ECN state trace chaining
    */
-  TracedCallback<TcpSocketState::EcnState_t, TcpSocketState::EcnState_t> m_ecnStateTrace;
+  TcpSocketStateTrace<TcpSocketState::EcnState_t> m_ecnStateTrace;
 
   /**
    * \brief Callback pointer for high tx mark chaining
    */
-  TracedCallback <SequenceNumber32, SequenceNumber32> m_highTxMarkTrace;
+  TcpSocketStateTrace<SequenceNumber32> m_highTxMarkTrace;
 
   /**
    * \brief Callback pointer for next tx sequence chaining
    */
-  TracedCallback<SequenceNumber32, SequenceNumber32> m_nextTxSequenceTrace;
+  TcpSocketStateTrace<SequenceNumber32> m_nextTxSequenceTrace;
 
   /**
    * \brief Callback pointer for bytesInFlight trace chaining
    */
-  TracedCallback<uint32_t, uint32_t> m_bytesInFlightTrace;
+  TcpSocketStateTrace<uint32_t> m_bytesInFlightTrace;
 
   /**
    * \brief Callback pointer for RTT trace chaining
    */
-  TracedCallback<Time, Time> m_lastRttTrace;
+  TcpSocketStateTrace<Time> m_lastRttTrace;
 
   /**
    * \brief Callback function to hook to TcpSocketState pacing rate
@@ -574,6 +950,18 @@ public:
    */
   void SetPaceInitialWindow (bool paceWindow);
 
+  /**
+   * \brief Get the number of empty segments built from a recycled packet
+   * \return the number of pool hits
+   */
+  uint64_t GetEmptyPacketPoolHits (void) const;
+
+  /**
+   * \brief Get the number of empty segments that needed a new packet
+   * \return the number of pool misses
+   */
+  uint64_t GetEmptyPacketPoolMisses (void) const;
+
   // Necessary implementations of null functions from ns3::Socket
   virtual enum SocketErrno GetErrno (void) const;    // returns m_errno
   virtual enum SocketType GetSocketType (void) const; // returns socket type
@@ -782,6 +1170,15 @@ protected:
    */
   virtual uint32_t SendDataPacket (SequenceNumber32 seq, uint32_t maxSize, bool withAck);
 
+  /**
+   * \brief Fire the Tx trace and send a data segment to TcpL4Protocol
+   *
+   * \param p the segment payload
+   * \param header the TCP header of the segment
+   * \param remainingData the data left in the TxBuffer after the segment (for logging)
+   */
+  void SendSegment (Ptr<Packet> p, const TcpHeader &header, uint32_t remainingData);
+
   /**
    * \brief Send a empty packet that carries a flag, e.g., ACK
    *
@@ -857,6 +1254,11 @@ protected:
    */
   void CancelAllTimers (void);
 
+  /**
+   * \brief Give the trace sources fed by m_tcb their traced value and Update* function
+   */
+  void SetTcbTraceSources (void);
+
   /**
    * \brief Move from CLOSING or FIN_WAIT_2 to TIME_WAIT state
    */
@@ -1061,6 +1463,55 @@ protected:
    */
   void EnterRecovery (uint32_t currentDelivered);
 
+  /**
+   * \brief Record the delivery of a segment for the time-based loss detection
+   *
+   * A retransmission acknowledged less than one minimum RTT after it was
+   * sent was probably delivered by the original transmission: it is
+   * ignored, as its send time is ambiguous.
+   *
+   * \param h the history entry of the segment (S)ACKed
+   */
+  void RackDelivered (const RttHistory &h);
+
+  /**
+   * \brief Check if the head is lost, from the send times (RACK, RFC 8985)
+   *
+   * The head is lost if a segment sent after its last transmission has
+   * been delivered, and if it is still not acknowledged one RTT plus a
+   * reordering window (a quarter of the minimum RTT) after that
+   * transmission. While the deadline is not reached, the reordering timer
+   * is armed to check again at the deadline.
+   *
+   * \param currentDelivered bytes (S)ACKed by the current ACK
+   * \return true if the head is considered lost
+   */
+  bool RackDetectLoss (uint32_t currentDelivered);
+
+  /**
+   * \brief The reordering timer expired: enter the recovery if the head is lost
+   *
+   * The delivered count passed to the recovery is read from the rate
+   * sampler: the bytes (S)ACKed since the ACK that armed the timer.
+   */
+  void RackTimeout (void);
+
+  /**
+   * \brief Arm the tail loss probe timer (TLP, RFC 8985)
+   *
+   * While data is outstanding in CA_OPEN, the probe timeout is two
+   * smoothed RTTs, plus the delayed ACK timeout when a single segment is
+   * in flight. The timer is not armed if the RTO would expire first.
+   */
+  void ArmTlp (void);
+
+  /**
+   * \brief Send the tail loss probe: retransmit the last segment sent, so
+   * that the receiver SACKs it and the losses before it are detected by
+   * RackDetectLoss without waiting for the RTO
+   */
+  void TlpTimeout (void);
+
   /**
    * \brief An RTO event happened
    */
@@ -1212,6 +1663,15 @@ protected:
    */
   void NotifyPacingPerformed (void);
 
+  /**
+   * \brief Notify the application of the new data sent since the last notification
+   *
+   * SendDataPacket accumulates the bytes of new data in m_dataSentBytes and
+   * schedules this function only once, so that a burst of segments sent in
+   * the same event results in a single data-sent notification.
+   */
+  void NotifyPendingDataSent (void);
+
   /**
    * \brief Return true if packets in the current window should be paced
    * \return true if pacing is currently enabled
@@ -1229,6 +1689,20 @@ protected:
    */
   void AddSocketTags (const Ptr<Packet> &p) const;
 
+  /**
+   * \brief Get an empty packet for SendEmptyPacket
+   *
+   * The packets of the pool are handed down to the lower layers and come
+   * back free (nobody else holding a reference) once they are delivered or
+   * dropped: such a packet is reset to a new empty packet, with a new UID,
+   * and reused. Otherwise a new packet is created, and kept in the pool if
+   * there is room. The hits and misses are exported as the
+   * EmptyPacketPoolHits and EmptyPacketPoolMisses attributes.
+   *
+   * \return an empty packet, without tags
+   */
+  Ptr<Packet> GetEmptyPacket (void);
+
   /**
    * Get the current value of the receiver's offered window (RCV.WND)
    * \note This method exists to expose the value to the TcpTxBuffer
@@ -1250,6 +1724,8 @@ protected:
   EventId           m_delAckEvent   {}; //!< Delayed ACK timeout event
   EventId           m_persistEvent  {}; //!< Persist event: Send 1 byte to probe for a non-zero Rx window
   EventId           m_timewaitEvent {}; //!< TIME_WAIT expiration event: Move this socket to CLOSED state
+  EventId           m_rackEvent     {}; //!< RACK reordering timer: check again if the head is lost
+  EventId           m_tlpEvent      {}; //!< Tail loss probe timer
 
   // ACK management
   uint32_t          m_dupAckCount {0};     //!< Dupack counter
@@ -1273,8 +1749,25 @@ protected:
   Time              m_persistTimeout   {Seconds (0.0)};   //!< Time between sending 1-byte probes
   Time              m_cnTimeout        {Seconds (0.0)};   //!< Timeout for connection retry
 
+  // Recycled packets of the empty segments
+  std::vector<Ptr<Packet> >   m_emptyPacketPool;          //!< Packets sent by SendEmptyPacket
+  uint32_t                    m_emptyPacketPoolSize {8};  //!< Maximum number of packets in the pool
+  uint64_t                    m_emptyPacketPoolHits {0};  //!< Empty segments built from a recycled packet
+  uint64_t                    m_emptyPacketPoolMisses {0}; //!< Empty segments built from a new packet
+
   // History of RTT
-  std::deque<RttHistory>      m_history;         //!< List of sent packet
+  RttHistoryBuffer            m_history;         //!< List of sent packet
+  bool                        m_indexedRttHistory {true}; //!< Search m_history with a binary search instead of a linear scan
+
+  // Segment-burst transmission
+  uint32_t                    m_gsoMaxSegments {1}; //!< Maximum number of segments of new data sent as one block
+  bool                        m_gsoIgnoredWarned {false}; //!< The burst mode was refused because of SACK or pacing
+
+  // Time-based loss detection (RACK and TLP)
+  bool                        m_timeBasedLossDetection {false}; //!< Detect the losses from the send times
+  Time                        m_rackXmitTime {Seconds (0.0)};  //!< Send time of the most recent transmission delivered
+  SequenceNumber32            m_rackEndSeq {0};                //!< End sequence of the most recent transmission delivered
+  uint64_t                    m_rackDelivered {0};             //!< Delivered count before the ACK that armed the reordering timer
 
   // Connections to other layers of TCP/IP
   Ipv4EndPoint*       m_endPoint  {nullptr}; //!< the IPv4 endpoint
@@ -1316,7 +1809,13 @@ protected:
   bool     m_timestampEnabled {true}; //!< Timestamp option enabled
   uint32_t m_timestampToEcho  {0};    //!< Timestamp to echo
 
+  // Options reused for the outgoing segments, see AddOptionTimestamp
+  Ptr<TcpOptionTS>   m_tsOption;   //!< Timestamp option of the last segment
+  Ptr<TcpOptionSack> m_sackOption; //!< SACK option of the last segment
+
   EventId m_sendPendingDataEvent {}; //!< micro-delay event to send pending data
+  EventId m_dataSentEvent {};        //!< Coalesced data-sent notification
+  uint32_t m_dataSentBytes {0};      //!< New bytes sent, not yet notified to the application
 
   // Fast Retransmit and Recovery
   SequenceNumber32       m_recover    {0};   //!< Previous highest Tx seqnum for fast recovery (set it to initial seq number)
@@ -1325,6 +1824,7 @@ protected:
                                                   //!< which was set for handling previous congestion event.
   uint32_t               m_retxThresh {3};   //!< Fast Retransmit threshold
   bool                   m_limitedTx  {true}; //!< perform limited transmit
+  bool                   m_keepCwnd   {false}; //!< The window is kept during the current fast recovery
 
   // Transmission Control Block
   Ptr<TcpSocketState>    m_tcb;               //!< Congestion control information
@@ -194,6 +194,7 @@ public:
   uint16_t               m_pacingSsRatio {0};        //!< SS pacing ratio
   uint16_t               m_pacingCaRatio {0};        //!< CA pacing ratio
   bool                   m_paceInitialWindow {false}; //!< Enable/Disable pacing for the initial window
+  DataRate               m_ccPacingRate {0};         //!< Pacing rate set by the congestion control, 0 to derive it from cWnd and the RTT
 
   Time                   m_minRtt  {Time::Max ()};   //!< Minimum RTT observed throughout the connection
 
@@ -208,10 +209,7 @@ public:
   EcnCodePoint_t         m_ectCodePoint {Ect0};  //!< ECT code point to use
 
   uint32_t               m_lastAckedSackedBytes {0}; //!< The number of bytes acked and sacked as indicated by the current ACK received. This is similar to acked_sacked variable in Linux
-  
-  SequenceNumber32 m_highTxAck               {0};  //!< Highest ack sent ---added
-  mutable uint32_t m_oldcWnd                 {0};  //!< For handling window inflation and deflation
-  
+
 
   /**
    * \brief Get cwnd in segments rather than bytes
@@ -0,0 +1,298 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include "tcp-general-test.h"
+#include "tcp-error-model.h"
+#include "ns3/node.h"
+#include "ns3/log.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("TcpTimeLossDetectionTestSuite");
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the RACK loss detection with a window too small for dupacks
+ *
+ * Three segments are sent and the second one is lost: the third one
+ * produces a single dupack, which is not enough for the fast retransmit.
+ * With the time-based loss detection, the reordering timer enters the
+ * recovery one RTT plus the reordering window after the lost segment was
+ * sent, long before the RTO.
+ */
+class TcpRackSmallWindowTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param desc test description
+   */
+  TcpRackSmallWindowTest (const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<TcpSocketMsgBase> CreateSenderSocket (Ptr<Node> node);
+  virtual Ptr<TcpSocketMsgBase> CreateReceiverSocket (Ptr<Node> node);
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                               const TcpSocketState::TcpCongState_t newValue);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_recovered;  //!< The recovery was entered
+  bool m_rtoExpired; //!< The RTO fired
+};
+
+TcpRackSmallWindowTest::TcpRackSmallWindowTest (const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_recovered (false),
+    m_rtoExpired (false)
+{
+}
+
+void
+TcpRackSmallWindowTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (3);
+  SetAppPktSize (500);
+  SetAppPktInterval (MilliSeconds (1));
+  SetPropagationDelay (MilliSeconds (10));
+}
+
+void
+TcpRackSmallWindowTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 10);
+}
+
+Ptr<TcpSocketMsgBase>
+TcpRackSmallWindowTest::CreateSenderSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateSenderSocket (node);
+  socket->SetAttribute ("TimeBasedLossDetection", BooleanValue (true));
+  return socket;
+}
+
+Ptr<TcpSocketMsgBase>
+TcpRackSmallWindowTest::CreateReceiverSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateReceiverSocket (node);
+  socket->SetAttribute ("DelAckCount", UintegerValue (1));
+  return socket;
+}
+
+Ptr<ErrorModel>
+TcpRackSmallWindowTest::CreateReceiverErrorModel ()
+{
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (501));
+  return errorModel;
+}
+
+void
+TcpRackSmallWindowTest::CongStateTrace (const TcpSocketState::TcpCongState_t oldValue,
+                                        const TcpSocketState::TcpCongState_t newValue)
+{
+  NS_LOG_FUNCTION (this << oldValue << newValue);
+  if (newValue == TcpSocketState::CA_RECOVERY)
+    {
+      NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, false, "Recovery entered after the RTO");
+      m_recovered = true;
+    }
+}
+
+void
+TcpRackSmallWindowTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who == SENDER)
+    {
+      m_rtoExpired = true;
+    }
+}
+
+void
+TcpRackSmallWindowTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_recovered, true, "Loss not detected from the send times");
+  NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, false, "Loss recovered by the RTO");
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief Testing the tail loss probe against the RTO
+ *
+ * Two segments are sent far apart, and the second one, the tail, is lost.
+ * It is alone in flight, so the probe timeout includes the delayed ACK
+ * timeout. With the default minimum RTO the probe fires first and
+ * retransmits the tail, and the RTO never fires. With a small minimum RTO
+ * the RTO would fire first: the probe is not armed, and the tail is
+ * retransmitted only by the RTO.
+ */
+class TcpTlpTest : public TcpGeneralTest
+{
+public:
+  /**
+   * \brief Constructor
+   * \param rtoFirst true if the RTO expires before the probe timeout
+   * \param desc test description
+   */
+  TcpTlpTest (bool rtoFirst, const std::string &desc);
+
+protected:
+  virtual void ConfigureEnvironment ();
+  virtual void ConfigureProperties ();
+  virtual Ptr<TcpSocketMsgBase> CreateSenderSocket (Ptr<Node> node);
+  virtual Ptr<TcpSocketMsgBase> CreateReceiverSocket (Ptr<Node> node);
+  virtual Ptr<ErrorModel> CreateReceiverErrorModel ();
+  virtual void Tx (const Ptr<const Packet> p, const TcpHeader&h, SocketWho who);
+  virtual void AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who);
+  virtual void FinalChecks ();
+
+private:
+  bool m_rtoFirst;          //!< The RTO expires before the probe timeout
+  bool m_rtoExpired;        //!< The RTO fired
+  uint32_t m_tailSent;      //!< Transmissions of the tail segment
+  bool m_retxAfterRto;      //!< The tail was retransmitted after the RTO
+};
+
+TcpTlpTest::TcpTlpTest (bool rtoFirst, const std::string &desc)
+  : TcpGeneralTest (desc),
+    m_rtoFirst (rtoFirst),
+    m_rtoExpired (false),
+    m_tailSent (0),
+    m_retxAfterRto (false)
+{
+}
+
+void
+TcpTlpTest::ConfigureEnvironment ()
+{
+  TcpGeneralTest::ConfigureEnvironment ();
+  SetAppPktCount (2);
+  SetAppPktSize (500);
+  SetAppPktInterval (MilliSeconds (100));
+  SetPropagationDelay (MilliSeconds (10));
+}
+
+void
+TcpTlpTest::ConfigureProperties ()
+{
+  TcpGeneralTest::ConfigureProperties ();
+  SetSegmentSize (SENDER, 500);
+  SetSegmentSize (RECEIVER, 500);
+  SetInitialCwnd (SENDER, 10);
+}
+
+Ptr<TcpSocketMsgBase>
+TcpTlpTest::CreateSenderSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateSenderSocket (node);
+  socket->SetAttribute ("TimeBasedLossDetection", BooleanValue (true));
+  if (m_rtoFirst)
+    {
+      // RTO of about 60 ms, probe timeout of about 240 ms
+      socket->SetAttribute ("MinRto", TimeValue (MilliSeconds (50)));
+    }
+  return socket;
+}
+
+Ptr<TcpSocketMsgBase>
+TcpTlpTest::CreateReceiverSocket (Ptr<Node> node)
+{
+  Ptr<TcpSocketMsgBase> socket = TcpGeneralTest::CreateReceiverSocket (node);
+  socket->SetAttribute ("DelAckCount", UintegerValue (1));
+  return socket;
+}
+
+Ptr<ErrorModel>
+TcpTlpTest::CreateReceiverErrorModel ()
+{
+  Ptr<TcpSeqErrorModel> errorModel = CreateObject<TcpSeqErrorModel> ();
+  errorModel->AddSeqToKill (SequenceNumber32 (501));
+  return errorModel;
+}
+
+void
+TcpTlpTest::Tx (const Ptr<const Packet> p, const TcpHeader &h, SocketWho who)
+{
+  if (who != SENDER || p->GetSize () == 0 || h.GetSequenceNumber () != SequenceNumber32 (501))
+    {
+      return;
+    }
+
+  ++m_tailSent;
+  if (m_tailSent > 1)
+    {
+      m_retxAfterRto = m_rtoExpired;
+    }
+}
+
+void
+TcpTlpTest::AfterRTOExpired (const Ptr<const TcpSocketState> tcb, SocketWho who)
+{
+  NS_LOG_FUNCTION (this << tcb << who);
+  if (who == SENDER)
+    {
+      m_rtoExpired = true;
+    }
+}
+
+void
+TcpTlpTest::FinalChecks ()
+{
+  NS_TEST_ASSERT_MSG_EQ (m_tailSent, 2u, "The tail must be retransmitted exactly once");
+  NS_TEST_ASSERT_MSG_EQ (m_rtoExpired, m_rtoFirst,
+                         (m_rtoFirst ? "The RTO did not fire" : "The probe did not prevent the RTO"));
+  NS_TEST_ASSERT_MSG_EQ (m_retxAfterRto, m_rtoFirst,
+                         (m_rtoFirst ? "Probe sent although the RTO expires first"
+                                     : "Tail not retransmitted by the probe"));
+}
+
+/**
+ * \ingroup internet-test
+ * \ingroup tests
+ *
+ * \brief TestSuite for the time-based loss detection of TcpSocketBase
+ */
+class TcpTimeLossDetectionTestSuite : public TestSuite
+{
+public:
+  TcpTimeLossDetectionTestSuite () : TestSuite ("tcp-time-loss-detection", UNIT)
+  {
+    AddTestCase (new TcpRackSmallWindowTest ("RACK recovery with a single dupack"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpTlpTest (false, "Tail loss probe before the RTO"),
+                 TestCase::QUICK);
+    AddTestCase (new TcpTlpTest (true, "No tail loss probe when the RTO expires first"),
+                 TestCase::QUICK);
+  }
+};
+
+static TcpTimeLossDetectionTestSuite g_tcpTimeLossDetectionTest; //!< Static variable for test initialization
@@ -1,10 +1,14 @@
 /*  WiFi Tcp Congestion Control for adhoc network*/
 
 #include <fstream>
+#include <sstream>
 #include <iostream>
 #include "ns3/command-line.h"
 #include "ns3/config.h"
+#include "ns3/rng-seed-manager.h"
 #include "ns3/string.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
 #include "ns3/log.h"
 #include "ns3/yans-wifi-helper.h"
 #include "ns3/ssid.h"
@@ -17,6 +21,9 @@
 #include "ns3/tcp-westwood.h"
 #include "ns3/tcp-veno.h"
 #include "ns3/tcp-cerl.h"
+#include "ns3/tcp-cerl-loss-oracle.h"
+#include "ns3/wifi-mac-queue-item.h"
+#include "ns3/regular-wifi-mac.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/ipv4-global-routing-helper.h"
@@ -25,6 +32,7 @@
 #include "ns3/pointer.h"
 #include "ns3/aodv-module.h"
 #include "ns3/ipv4-list-routing-helper.h"
+#include "scenario-csv.h"
 
 NS_LOG_COMPONENT_DEFINE ("wifi-tcp");
 
@@ -32,6 +40,32 @@ using namespace ns3;
 
 Ptr<PacketSink> sink;                         /* Pointer to the packet sink application */
 
+static void
+WifiMacDroppedMpdu (Ptr<TcpCerlLossOracle> oracle, WifiMacDropReason reason,
+                    Ptr<const WifiMacQueueItem> item)
+{
+  switch (reason)
+    {
+    case WIFI_MAC_DROP_FAILED_ENQUEUE:
+      oracle->NotifyDrop (item->GetPacket (), TcpCerlLossOracle::QUEUE_OVERFLOW);
+      break;
+    case WIFI_MAC_DROP_EXPIRED_LIFETIME:
+      oracle->NotifyDrop (item->GetPacket (), TcpCerlLossOracle::QUEUE_EXPIRED);
+      break;
+    case WIFI_MAC_DROP_REACHED_RETRY_LIMIT:
+    default:
+      // The MAC gave up on the frame
+      oracle->NotifyDrop (item->GetPacket (), TcpCerlLossOracle::MAC_FAILURE);
+      break;
+    }
+}
+
+static void
+WifiPhyRxError (Ptr<TcpCerlLossOracle> oracle, Ptr<const Packet> packet, double snr)
+{
+  oracle->NotifyDrop (packet, TcpCerlLossOracle::PHY_ERROR);
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -42,6 +76,11 @@ main (int argc, char *argv[])
   double simulationTime = 0.3;                         /* Simulation time in seconds. */
   bool pcapTracing = false;                          /* PCAP Tracing is enabled or not. */
   uint32_t m_protocol=2;
+  std::string flowmonFile = "";                      /* FlowMonitor XML output file (empty to disable). */
+  std::string resultsFile = "";                      /* Per-flow CSV results file, appended to (empty to disable). */
+  bool printFlows = false;                           /* Print the statistics of each flow. */
+  std::string lossOracleFile = "";                   /* Loss classification confusion matrix CSV file, appended to (empty to disable). */
+  uint32_t gsoMaxSegments = 1;                       /* Segments of new data built at once (1 to disable). */
 
   int nWifis=30;
   int nodeSpeed = 10; //in m/s
@@ -59,6 +98,17 @@ main (int argc, char *argv[])
   cmd.AddValue ("simulationTime", "Simulation time in seconds", simulationTime);
   cmd.AddValue ("pcap", "Enable/disable PCAP Tracing", pcapTracing);
   cmd.AddValue ("protocol", "1=OLSR;2=AODV;3=DSDV;4=DSR", m_protocol);
+  cmd.AddValue ("nWifis", "Number of wifi nodes", nWifis);
+  cmd.AddValue ("nodeSpeed", "Maximum node speed in m/s", nodeSpeed);
+  cmd.AddValue ("nodePause", "Node pause time in s", nodePause);
+  cmd.AddValue ("flowmonFile", "Write FlowMonitor statistics to this XML file", flowmonFile);
+  cmd.AddValue ("resultsFile", "Append per-flow statistics to this CSV file", resultsFile);
+  cmd.AddValue ("printFlows", "Print the statistics of each flow", printFlows);
+  cmd.AddValue ("lossOracleFile", "Score the TcpCerl loss classifications against the actual "
+                "drop causes and append the confusion matrix to this CSV file", lossOracleFile);
+  cmd.AddValue ("gsoMaxSegments", "Build new data in bursts of up to this many segments "
+                "(1 to disable). SACK is disabled, as the bursts are only used without it",
+                gsoMaxSegments);
   cmd.Parse (argc, argv);
 
   // Select TCP variant
@@ -75,6 +125,11 @@ main (int argc, char *argv[])
 
   /* Configure TCP Options */
   Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (payloadSize));
+  if (gsoMaxSegments > 1)
+    {
+      Config::SetDefault ("ns3::TcpSocketBase::Sack", BooleanValue (false));
+      Config::SetDefault ("ns3::TcpSocketBase::GsoMaxSegments", UintegerValue (gsoMaxSegments));
+    }
 
   WifiMacHelper wifiMac;
   WifiHelper wifiHelper;
@@ -134,6 +189,22 @@ main (int argc, char *argv[])
   Ipv4InterfaceContainer networkInterfaces;
   networkInterfaces = address.Assign (networkDevices);
 
+  /* Ground truth of the loss classifications */
+  Ptr<TcpCerlLossOracle> oracle;
+  if (!lossOracleFile.empty ())
+    {
+      oracle = CreateObject<TcpCerlLossOracle> ();
+      oracle->Install (networkNodes);
+      // The Drop trace of the MAC queues does not tell an overflow from an
+      // expired lifetime, and misses the retry failures: use the MAC drops
+      Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Mac/$ns3::RegularWifiMac/DroppedMpdu",
+                                     MakeBoundCallback (&WifiMacDroppedMpdu, oracle));
+      Config::ConnectWithoutContext ("/NodeList/*/DeviceList/*/$ns3::WifiNetDevice/Phy/State/RxError",
+                                     MakeBoundCallback (&WifiPhyRxError, oracle));
+      // The sockets are created when the applications start
+      Simulator::Schedule (MilliSeconds (1), &TcpCerlLossOracle::ConnectCongestionOps, oracle, networkNodes);
+    }
+
   /* Install TCP Receiver on the access point */
   PacketSinkHelper sinkHelper ("ns3::TcpSocketFactory", InetSocketAddress (Ipv4Address::GetAny (), 9));
   ApplicationContainer sinkApp = sinkHelper.Install (networkNodes);
@@ -161,14 +232,7 @@ main (int argc, char *argv[])
   std::map<FlowId, FlowMonitor::FlowStats> stats = monitor->GetFlowStats ();
 
   int count=0;
-  /*float thr=0.0,dr=0.0,lr=0.0;
-  float dl=0.0;
-  std::ofstream myfile1,myfile2,myfile3,myfile4;
-  myfile1.open ("throughput_c.txt");
-  myfile2.open ("delay_c.txt");
-  myfile3.open ("delivery-ratio_c.txt");
-  myfile4.open ("loss-ratio_c.txt");
-  */
+  std::ostringstream results;                       /* Per-flow CSV rows, written once after the run */
   for (std::map<FlowId, FlowMonitor::FlowStats>::const_iterator iter = stats.begin (); iter != stats.end (); ++iter)
   {
 	  Ipv4FlowClassifier::FiveTuple t = classifier->FindFlow (iter->first);
@@ -178,40 +242,77 @@ main (int argc, char *argv[])
           
           count++;
           
-          NS_LOG_UNCOND("-------------------------------------------------------------");
-          NS_LOG_UNCOND("Flow ID:" <<iter->first);
-          NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
-          NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
-          NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
-          NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
-          NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
-          NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
-          /*
-          thr=iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024;
-          if(thr==-0) thr=0; 
-          dl=iter->second.delaySum.GetSeconds();
-          dr=iter->second.rxPackets*100/iter->second.txPackets ;
-          lr=(iter->second.txPackets-iter->second.rxPackets)*100/iter->second.txPackets;
-          
-          myfile1<< count<<" "<<thr<<"\n";
-          myfile2 << count<<" "<<dl<<"\n";
-          myfile3 << count<<" "<<dr<<"\n";
-          myfile4<< count<<" "<<lr<<"\n";         
-          */
+          if (printFlows)
+            {
+              NS_LOG_UNCOND("-------------------------------------------------------------");
+              NS_LOG_UNCOND("Flow ID:" <<iter->first);
+              NS_LOG_UNCOND("Source Address: " <<t.sourceAddress << ",  Destination Address: "<< t.destinationAddress);
+              NS_LOG_UNCOND("Source Port: " <<t.sourcePort << ",  Destination Port: "<< t.destinationPort);
+              NS_LOG_UNCOND("Packet delivery ratio =" <<((iter->second.rxPackets*1.0)*100/iter->second.txPackets) << "%");
+              NS_LOG_UNCOND("Packet loss ratio =" << ((iter->second.txPackets-iter->second.rxPackets)*1.0)*100/iter->second.txPackets << "%");
+              NS_LOG_UNCOND("End-to-end delay =" <<iter->second.delaySum.GetSeconds()<<"s");
+              NS_LOG_UNCOND("Throughput =" <<iter->second.rxBytes * 8.0/(iter->second.timeLastRxPacket.GetSeconds()-iter->second.timeFirstTxPacket.GetSeconds())/1024/1024<<"Mbps");
+            }
+          if (!resultsFile.empty ())
+            {
+              double duration = iter->second.timeLastRxPacket.GetSeconds () - iter->second.timeFirstTxPacket.GetSeconds ();
+              results << "wifi," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+                      << "," << nWifis << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+                      << "," << iter->first << "," << t.sourceAddress << "," << t.destinationAddress
+                      << "," << t.sourcePort << "," << t.destinationPort
+                      << "," << iter->second.txPackets << "," << iter->second.rxPackets << "," << iter->second.lostPackets
+                      << "," << iter->second.txBytes << "," << iter->second.rxBytes
+                      << "," << iter->second.delaySum.GetSeconds ()
+                      << "," << iter->second.timeFirstTxPacket.GetSeconds ()
+                      << "," << iter->second.timeLastRxPacket.GetSeconds ()
+                      << "," << CsvRatio (iter->second.rxPackets * 100.0, iter->second.txPackets)
+                      << "," << CsvRatio ((static_cast<double> (iter->second.txPackets) - iter->second.rxPackets) * 100.0,
+                                          iter->second.txPackets)
+                      << "," << CsvRatio (iter->second.rxBytes * 8.0 / 1024 / 1024, duration)
+                      << "\n";
+            }
   }
-  /*
-  myfile1.close();
-  myfile2.close();
-  myfile3.close();
-  myfile4.close();
-  */
+  if (!resultsFile.empty ())
+    {
+      AppendCsv (resultsFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "flowId,sourceAddress,destinationAddress,sourcePort,destinationPort,"
+                 "txPackets,rxPackets,lostPackets,txBytes,rxBytes,delaySum,"
+                 "timeFirstTxPacket,timeLastRxPacket,deliveryRatio,lossRatio,throughput\n",
+                 results.str ());
+    }
+  if (oracle)
+    {
+      std::ostringstream matrix;
+      oracle->Print (matrix);
+      NS_LOG_UNCOND ("------------------------------------------");
+      NS_LOG_UNCOND ("Loss classifications:\n" << matrix.str ());
+
+      std::ostringstream rows;
+      for (uint32_t i = 0; i <= TcpCerlLossOracle::UNKNOWN; ++i)
+        {
+          TcpCerlLossOracle::DropCause_t cause = static_cast<TcpCerlLossOracle::DropCause_t> (i);
+          rows << "wifi," << tcpVariant << "," << RngSeedManager::GetSeed () << "," << RngSeedManager::GetRun ()
+               << "," << nWifis << "," << nodeSpeed << "," << dataRate << "," << payloadSize << "," << simulationTime
+               << "," << TcpCerlLossOracle::DropCauseName[i]
+               << "," << oracle->GetCount (cause, TcpCerl::CONGESTIVE_LOSS)
+               << "," << oracle->GetCount (cause, TcpCerl::RANDOM_LOSS)
+               << "\n";
+        }
+      AppendCsv (lossOracleFile,
+                 "scenario,tcpVariant,seed,run,nodes,nodeSpeed,dataRate,payloadSize,simulationTime,"
+                 "cause,congestive,random\n",
+                 rows.str ());
+    }
+  if (!flowmonFile.empty ())
+    {
+      flowmon.SerializeToXmlFile (flowmonFile, false, false);
+    }
   Simulator::Destroy ();
   
   NS_LOG_UNCOND("------------------------------------------");
   NS_LOG_UNCOND("Total flows: " <<count);
   
-  //monitor->SerializeToXmlFile("tcp-new-reno.xml", true, true);
- 
   return 0;
 }
 
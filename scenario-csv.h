@@ -0,0 +1,60 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * CSV output shared by the scenario programs (wifi-tcp-cerl, wifi-tcp-reno,
+ * lrwpan-cerl, lrwpan-reno).  Copy it into scratch/ along with them.
+ */
+
+#ifndef SCENARIO_CSV_H
+#define SCENARIO_CSV_H
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "ns3/abort.h"
+
+/* Ratio written to the CSV files, empty when the denominator is zero */
+inline std::string
+CsvRatio (double numerator, double denominator)
+{
+  if (denominator <= 0)
+    {
+      return "";
+    }
+  std::ostringstream os;
+  os << numerator / denominator;
+  return os.str ();
+}
+
+/* Append rows to a CSV file, with the header first if the file is new or empty */
+inline void
+AppendCsv (const std::string &fileName, const std::string &header, const std::string &rows)
+{
+  std::ifstream existing (fileName.c_str ());
+  bool writeHeader = !existing.good () || existing.peek () == std::ifstream::traits_type::eof ();
+  existing.close ();
+
+  std::ofstream out (fileName.c_str (), std::ios::out | std::ios::app);
+  NS_ABORT_MSG_UNLESS (out.is_open (), "Cannot open CSV file " << fileName);
+  if (writeHeader)
+    {
+      out << header;
+    }
+  out << rows;
+}
+
+#endif /* SCENARIO_CSV_H */
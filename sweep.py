@@ -0,0 +1,185 @@
+#! /usr/bin/env python3
+## -*- Mode: python; py-indent-offset: 4; indent-tabs-mode: nil; coding: utf-8; -*-
+"""
+Parameter sweep runner for the CERL and Reno scenario programs.
+
+Every scenario program (wifi-tcp-cerl, wifi-tcp-reno, lrwpan-cerl,
+lrwpan-reno) simulates a single configuration per process.  This script
+expands a parameter grid, runs each point as an independent ns-3 process
+(with a deterministic RngRun) on as many local cores as requested, and
+merges the per-run flow statistics (the --resultsFile CSV written by each
+program) into a single CSV file.
+
+Example:
+
+  ./sweep.py --ns3-dir ~/ns-3.33 --program wifi-tcp-cerl --program lrwpan-cerl \\
+      --tcp-variant TcpCerl --tcp-variant TcpNewReno \\
+      --nodes 10 --nodes 20 --nodes 30 --node-speed 5 --node-speed 10 \\
+      --runs 10 --output results.csv
+
+The programs must already be built (./waf build); they are run directly
+from the build tree, not through ./waf --run, so that many of them can
+execute concurrently.
+
+The programs include scenario-csv.h, which must be copied into scratch/
+along with them.
+"""
+
+import argparse
+import concurrent.futures
+import csv
+import glob
+import itertools
+import os
+import subprocess
+import sys
+
+DEFAULT_PROGRAMS = ['wifi-tcp-cerl', 'wifi-tcp-reno', 'lrwpan-cerl', 'lrwpan-reno']
+
+# Name of the command line argument holding the node count in each program
+NODES_ARGUMENT = {
+    'wifi': 'nWifis',
+    'lrwpan': 'nNodes',
+}
+
+
+def find_program(ns3_dir, program):
+    """Return the path of the built executable of a scenario program."""
+    if os.path.isfile(program) and os.access(program, os.X_OK):
+        return program
+    pattern = os.path.join(ns3_dir, 'build', 'scratch', '**', '*%s*' % program)
+    candidates = [path for path in glob.glob(pattern, recursive=True)
+                  if os.path.isfile(path) and os.access(path, os.X_OK)
+                  and os.path.basename(path).startswith('ns3')]
+    if not candidates:
+        sys.exit("error: no executable for %r below %s/build/scratch "
+                 "(did you run ./waf build?)" % (program, ns3_dir))
+    # Prefer the most recently built profile (debug/optimized)
+    return max(candidates, key=os.path.getmtime)
+
+
+def nodes_argument(program):
+    for prefix, argument in NODES_ARGUMENT.items():
+        if os.path.basename(program).find(prefix) != -1:
+            return argument
+    sys.exit("error: don't know how to set the node count of %r" % program)
+
+
+def run_one(job):
+    """Run a single simulation; return (job, exit status)."""
+    with open(job['log'], 'w') as log:
+        status = subprocess.call(job['argv'], stdout=log, stderr=subprocess.STDOUT,
+                                 env=job['env'])
+    return job, status
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--ns3-dir', default='.',
+                        help='ns-3 source tree with the scenarios built in build/scratch')
+    parser.add_argument('--program', action='append',
+                        help='scenario program name or executable path (repeatable, '
+                        'default: %s)' % ', '.join(DEFAULT_PROGRAMS))
+    parser.add_argument('--tcp-variant', action='append', help='TCP variant (repeatable)')
+    parser.add_argument('--nodes', action='append', type=int,
+                        help='number of nodes, nWifis/nNodes (repeatable)')
+    parser.add_argument('--node-speed', action='append', type=int,
+                        help='maximum node speed in m/s (repeatable)')
+    parser.add_argument('--data-rate', action='append',
+                        help='application data rate (repeatable)')
+    parser.add_argument('--payload-size', action='append', type=int,
+                        help='payload size in bytes (repeatable)')
+    parser.add_argument('--runs', type=int, default=1,
+                        help='number of RngRun values per grid point (default: 1)')
+    parser.add_argument('--first-run', type=int, default=1,
+                        help='first RngRun value (default: 1)')
+    parser.add_argument('--arg', action='append', default=[],
+                        help='extra argument passed verbatim to every program')
+    parser.add_argument('--jobs', '-j', type=int, default=os.cpu_count(),
+                        help='number of simulations run in parallel (default: all cores)')
+    parser.add_argument('--work-dir', default='sweep-output',
+                        help='directory for per-run logs and results files')
+    parser.add_argument('--output', default='sweep-results.csv',
+                        help='merged CSV output file')
+    args = parser.parse_args(argv)
+
+    ns3_dir = os.path.abspath(args.ns3_dir)
+    env = dict(os.environ)
+    libdir = os.path.join(ns3_dir, 'build', 'lib')
+    env['LD_LIBRARY_PATH'] = os.pathsep.join(
+        filter(None, [libdir, env.get('LD_LIBRARY_PATH')]))
+
+    # Dimensions that are left unset keep the program's own default
+    grid = [
+        ('tcpVariant', args.tcp_variant),
+        ('nodes', args.nodes),
+        ('nodeSpeed', args.node_speed),
+        ('dataRate', args.data_rate),
+        ('payloadSize', args.payload_size),
+        ('run', range(args.first_run, args.first_run + args.runs)),
+    ]
+    grid = [(name, values if values else [None]) for name, values in grid]
+
+    os.makedirs(args.work_dir, exist_ok=True)
+    jobs = []
+    for program in args.program or DEFAULT_PROGRAMS:
+        executable = find_program(ns3_dir, program)
+        name = os.path.basename(program)
+        for point in itertools.product(*[values for _, values in grid]):
+            params = dict(zip([name for name, _ in grid], point))
+            argv = [executable]
+            for key, value in params.items():
+                if value is None:
+                    continue
+                if key == 'nodes':
+                    argv.append('--%s=%d' % (nodes_argument(name), value))
+                elif key == 'run':
+                    argv.append('--RngRun=%d' % value)
+                else:
+                    argv.append('--%s=%s' % (key, value))
+            tag = '-'.join([name] + ['%s' % value for value in point if value is not None])
+            results = os.path.join(args.work_dir, tag + '.csv')
+            if os.path.exists(results):
+                # The programs append to the results file
+                os.remove(results)
+            argv.append('--resultsFile=%s' % results)
+            argv.extend(args.arg)
+            params['program'] = name
+            jobs.append({'params': params, 'argv': argv, 'env': env,
+                         'results': results, 'log': os.path.join(args.work_dir, tag + '.log')})
+
+    print('Running %d simulations on %d cores' % (len(jobs), args.jobs))
+    failed = 0
+    columns = None
+    rows = []
+    with concurrent.futures.ThreadPoolExecutor(max_workers=args.jobs) as executor:
+        for done, (job, status) in enumerate(executor.map(run_one, jobs), 1):
+            if status != 0:
+                failed += 1
+                print('[%d/%d] FAILED (%d): %s, see %s'
+                      % (done, len(jobs), status, ' '.join(job['argv']), job['log']))
+                continue
+            print('[%d/%d] done: %s' % (done, len(jobs), os.path.basename(job['results'])))
+            if not os.path.exists(job['results']):
+                # No flow delivered anything in this run
+                continue
+            with open(job['results'], newline='') as results:
+                reader = csv.DictReader(results)
+                columns = columns or ['program'] + reader.fieldnames
+                for row in reader:
+                    row['program'] = job['params']['program']
+                    rows.append(row)
+
+    with open(args.output, 'w', newline='') as output:
+        if columns:
+            writer = csv.DictWriter(output, fieldnames=columns)
+            writer.writeheader()
+            writer.writerows(rows)
+    print('Wrote %d flows to %s' % (len(rows), args.output))
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv[1:]))